@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/binary_logging.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "recording_logger.h"
+
+using android::base::FlushBinaryLogs;
+using android::base::LogSeverity;
+
+TEST(binary_logging, LOGB_arithmetic) {
+  ScopedRecordingLogger logger;
+  LOGB(INFO, "{} {} {:.2f} {:#x} {}", 1, -2L, 3.5, 255u, true);
+  FlushBinaryLogs();
+  EXPECT_EQ(std::vector<std::string>{"1 -2 3.50 0xff true"}, logger.Messages());
+  EXPECT_EQ(std::vector<LogSeverity>{android::base::INFO}, logger.Severities());
+}
+
+TEST(binary_logging, LOGB_strings) {
+  ScopedRecordingLogger logger;
+  std::string s = "string";
+  const char* null_string = nullptr;
+  char array[] = "array";
+  LOGB(WARNING, "{} {} {} {} {}", "literal", s, std::string_view("view"), null_string, array);
+  // The arguments are copied, so changing them afterwards doesn't affect the message.
+  s = "changed";
+  array[0] = 'A';
+  FlushBinaryLogs();
+  EXPECT_EQ(std::vector<std::string>{"literal string view (null) array"}, logger.Messages());
+}
+
+TEST(binary_logging, LOGB_format_specs) {
+  ScopedRecordingLogger logger;
+  int i = 0;
+  const void* pointer = &i;
+  // Strings are checked against how they're decoded, so their format specs must suit a
+  // string_view: LOGB(INFO, "{:p}", "literal") doesn't compile, rather than failing on the
+  // background thread. Pointers other than strings can still be formatted with {:p}.
+  LOGB(INFO, "[{:>6}] [{:.3}] {:p}", "right", std::string("truncated"), pointer);
+  FlushBinaryLogs();
+  EXPECT_EQ(std::vector<std::string>{fmt::format("[ right] [tru] {:p}", pointer)},
+            logger.Messages());
+}
+
+TEST(binary_logging, LOGB_no_arguments) {
+  ScopedRecordingLogger logger;
+  LOGB(INFO, "no arguments");
+  FlushBinaryLogs();
+  EXPECT_EQ(std::vector<std::string>{"no arguments"}, logger.Messages());
+}
+
+TEST(binary_logging, LOGB_preserves_order) {
+  ScopedRecordingLogger logger;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 5000; ++i) {
+    LOGB(INFO, "{}", i);
+    expected.push_back(std::to_string(i));
+  }
+  FlushBinaryLogs();
+  EXPECT_EQ(expected, logger.Messages());
+}
+
+TEST(binary_logging, LOGB_oversized_arguments) {
+  ScopedRecordingLogger logger;
+  std::string big(android::base::log_detail::kBinaryLogArgsSize, 'x');
+  LOGB(INFO, "first");
+  LOGB(INFO, "{}", big);
+  FlushBinaryLogs();
+  EXPECT_EQ((std::vector<std::string>{"first", big}), logger.Messages());
+}
+
+TEST(binary_logging, LOGB_disabled_does_not_evaluate_arguments) {
+  ScopedRecordingLogger logger;
+  android::base::ScopedLogSeverity sls(android::base::WARNING);
+  int evaluated = 0;
+  LOGB(INFO, "{}", ++evaluated);
+  EXPECT_EQ(0, evaluated);
+  FlushBinaryLogs();
+  EXPECT_TRUE(logger.Messages().empty());
+}
+
+TEST(binary_logging, LOGB_FATAL_WITHOUT_ABORT_flushes_pending) {
+  ScopedRecordingLogger logger;
+  LOGB(INFO, "pending");
+  LOGB(FATAL_WITHOUT_ABORT, "fatal {}", 1);
+  FlushBinaryLogs();
+  EXPECT_EQ((std::vector<std::string>{"pending", "fatal 1"}), logger.Messages());
+}
+
+TEST(binary_logging, LOG_FATAL_flushes_pending) {
+  ASSERT_DEATH(
+      {
+        android::base::SetLogger(android::base::StderrLogger);
+        LOGB(ERROR, "pending {}", 42);
+        LOG(FATAL) << "fatal";
+      },
+      "pending 42(.|\n)*fatal");
+}
+
+TEST(binary_logging, FATAL_WITHOUT_ABORT_waits_for_messages_being_queued) {
+  // Each thread logs an increasing count, and publishes the last one that was accepted.  Whatever
+  // was accepted before a FATAL message is logged must be written ahead of it, even if a thread
+  // that's still copying a message into the queue sits in front of it.
+  constexpr int kThreads = 4;
+  std::atomic<int> accepted[kThreads] = {};
+  std::atomic<bool> stop{false};
+  std::mutex lock;
+  std::vector<int> written(kThreads, 0);
+  std::vector<std::vector<int>> fatal_snapshots;
+  android::base::LogFunction old_logger = android::base::SetLogger(
+      [&](android::base::LogId, LogSeverity, const char*, const char*, unsigned int,
+          const char* message) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (std::string_view(message) == "fatal") {
+          fatal_snapshots.emplace_back(written);
+          return;
+        }
+        int thread, count;
+        ASSERT_EQ(2, sscanf(message, "%d:%d", &thread, &count));
+        written[thread] = std::max(written[thread], count);
+      });
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int count = 1; !stop.load(); ++count) {
+        LOGB(INFO, "{}:{}", i, count);
+        accepted[i].store(count);
+      }
+    });
+  }
+  std::vector<std::vector<int>> expected;
+  for (int i = 0; i < 200; ++i) {
+    std::vector<int> snapshot;
+    for (auto& count : accepted) snapshot.push_back(count.load());
+    LOG(FATAL_WITHOUT_ABORT) << "fatal";
+    expected.emplace_back(std::move(snapshot));
+  }
+  stop = true;
+  for (auto& thread : threads) thread.join();
+  FlushBinaryLogs();
+  android::base::SetLogger(std::move(old_logger));
+
+  std::lock_guard<std::mutex> guard(lock);
+  ASSERT_EQ(expected.size(), fatal_snapshots.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    for (int thread = 0; thread < kThreads; ++thread) {
+      ASSERT_GE(fatal_snapshots[i][thread], expected[i][thread]) << i << " " << thread;
+    }
+  }
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace base {
+
+// A bounded multi-producer/multi-consumer queue (Dmitry Vyukov's design).  Each slot carries a
+// sequence number that tells producers and consumers whose turn it is, so neither side ever takes
+// a lock.  Elements live in the slots for the life of the queue and are filled and emptied in
+// place, so element types that own memory (like std::string) keep their capacity between uses.
+template <typename T>
+class BoundedQueue {
+ public:
+  // `capacity` is rounded up to the next power of two.
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    slots_.reset(new Slot[size]);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Calls `fill(T&)` on a free slot and publishes it.  Returns false if the queue is full.
+  template <typename F>
+  bool TryPush(F&& fill) {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          fill(slot.value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Calls `consume(T&)` on the oldest element and frees its slot.  Returns false if the queue is
+  // empty.  The slot can't be reused until `consume` returns, so it should be quick: move or swap
+  // the element out rather than processing it in place.
+  template <typename F>
+  bool TryPop(F&& consume) {
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          consume(slot.value);
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns the position the next push will claim.  Every element that has been pushed, or that a
+  // producer has started to push, lies before it.
+  size_t PushPosition() const { return push_pos_.load(std::memory_order_acquire); }
+
+  // Like TryPop(), but only pops elements before `end`, a position returned by PushPosition(), and
+  // waits for a producer that has claimed one of those slots to publish it rather than returning
+  // false.  This lets a consumer drain everything pushed before some point, even when producers
+  // are still filling slots in front of later, already published, ones.
+  template <typename F>
+  bool PopBefore(size_t end, F&& consume) {
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (static_cast<intptr_t>(pos - end) < 0) {
+      Slot& slot = slots_[pos & mask_];
+      size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          consume(slot.value);
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else {
+        // Either another consumer took the slot, or its producer is still filling it.
+        if (diff < 0) std::this_thread::yield();
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    return false;
+  }
+
+  bool IsEmpty() const {
+    size_t pos = pop_pos_.load(std::memory_order_acquire);
+    return slots_[pos & mask_].sequence.load(std::memory_order_acquire) != pos + 1;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  std::atomic<size_t> push_pos_{0};
+  std::atomic<size_t> pop_pos_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(BoundedQueue);
+};
+
+// Lets a consumer thread sleep until producers have published work, without producers taking a
+// lock unless the consumer is actually asleep.
+class Doorbell {
+ public:
+  Doorbell() = default;
+
+  // Called by producers after publishing work.
+  void Ring() {
+    // Pairs with the fence in Wait(): either we see that the consumer is waiting, or the consumer
+    // sees our work.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(lock_);
+      cv_.notify_one();
+    }
+  }
+
+  // Called by the consumer.  Sleeps until `has_work()` returns true or Close() is called, and
+  // returns false in the latter case.
+  template <typename F>
+  bool Wait(F&& has_work) {
+    std::unique_lock<std::mutex> lock(lock_);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!closed_ && !has_work()) {
+      cv_.wait(lock);
+    }
+    waiting_.store(false, std::memory_order_relaxed);
+    return !closed_;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::atomic<bool> waiting_{false};
+  // Guarded by lock_.
+  bool closed_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(Doorbell);
+};
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bounded_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using android::base::BoundedQueue;
+
+TEST(bounded_queue, push_pop) {
+  BoundedQueue<int> queue(3);
+  EXPECT_TRUE(queue.IsEmpty());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.TryPush([i](int& value) { value = i; }));
+  }
+  // The capacity was rounded up to 4.
+  EXPECT_FALSE(queue.TryPush([](int&) {}));
+
+  for (int i = 0; i < 4; ++i) {
+    int value = -1;
+    EXPECT_TRUE(queue.TryPop([&value](int& queued) { value = queued; }));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(queue.TryPop([](int&) {}));
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(bounded_queue, PopBefore_waits_for_claimed_slots) {
+  BoundedQueue<int> queue(8);
+  queue.TryPush([](int& value) { value = 1; });
+
+  // A producer claims the next slot and is still filling it when a later one is published.
+  std::atomic<bool> filling{false};
+  std::atomic<bool> release{false};
+  std::thread slow_producer([&] {
+    queue.TryPush([&](int& value) {
+      filling = true;
+      while (!release) std::this_thread::yield();
+      value = 2;
+    });
+  });
+  while (!filling) std::this_thread::yield();
+  queue.TryPush([](int& value) { value = 3; });
+  size_t end = queue.PushPosition();
+  queue.TryPush([](int& value) { value = 4; });
+
+  // TryPop() stops at the claimed slot.
+  std::vector<int> popped;
+  auto consume = [&popped](int& value) { popped.push_back(value); };
+  while (queue.TryPop(consume)) {
+  }
+  EXPECT_EQ(std::vector<int>{1}, popped);
+
+  // PopBefore() waits for it, and stops at `end`.
+  std::thread consumer([&] {
+    while (queue.PopBefore(end, consume)) {
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  release = true;
+  slow_producer.join();
+  consumer.join();
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), popped);
+
+  EXPECT_FALSE(queue.PopBefore(end, consume));
+  EXPECT_TRUE(queue.PopBefore(queue.PushPosition(), consume));
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), popped);
+}
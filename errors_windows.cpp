@@ -56,7 +56,7 @@ std::string SystemErrorCodeToString(int int_error_code) {
   }
 
   // Messages returned by the system end with line breaks.
-  msg = android::base::Trim(msg);
+  android::base::TrimInPlace(&msg);
 
   // There are many Windows error messages compared to POSIX, so include the
   // numeric error code for easier, quicker, accurate identification. Use
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/flight_recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "android-base/file.h"
+#include "android-base/mapped_file.h"
+#include "android-base/threads.h"
+#include "android-base/unique_fd.h"
+
+namespace android {
+namespace base {
+
+// The file starts with a FileHeader, followed by the circular buffer.  Writers reserve space for
+// a record by advancing `head`, the number of bytes reserved since the buffer was created, so a
+// record's position in that stream identifies both where it lives (position % capacity) and
+// whether it has since been overwritten (once head > position + capacity).  Records never wrap
+// around the end of the buffer: one that doesn't fit before the end goes at the start instead,
+// and the gap is skipped by the reader like any other invalid data.
+
+static constexpr uint32_t kFileMagic = 0x52464c46;  // "FLFR"
+static constexpr uint32_t kFileVersion = 1;
+static constexpr uint32_t kRecordMagic = 0x43455246;  // "FREC"
+
+// Records are 8-byte aligned, so the reader only needs to look for them at multiples of 8.
+static constexpr size_t kAlignment = 8;
+static constexpr size_t kMinimumSize = 4096;
+// Tags and file names longer than this are truncated, so that they leave room for the message.
+static constexpr size_t kMaxNameSize = 256;
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  std::atomic<uint64_t> head;
+  uint8_t reserved[40];
+};
+static_assert(sizeof(FileHeader) == 64);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Everything in a record but its magic and checksum.  The checksum covers these fields and the
+// tag, file name and message that follow them.
+struct RecordFields {
+  uint64_t position;
+  int64_t time_ns;
+  uint64_t tid;
+  int32_t pid;
+  uint32_t line;
+  uint32_t message_size;
+  uint16_t tag_size;
+  uint16_t file_size;
+  uint8_t id;
+  uint8_t severity;
+  uint8_t reserved[6];
+};
+
+struct RecordHeader {
+  // kRecordMagic once the rest of the record has been written.
+  std::atomic<uint32_t> magic;
+  uint32_t checksum;
+  RecordFields fields;
+};
+static_assert(sizeof(RecordHeader) % kAlignment == 0);
+
+static constexpr size_t Align(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// 32-bit FNV-1a.
+static uint32_t Checksum(uint32_t hash, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static constexpr uint32_t kChecksumSeed = 2166136261u;
+
+struct FlightRecorder::State {
+  std::unique_ptr<MappedFile> mapping;
+  FileHeader* header = nullptr;
+  char* data = nullptr;
+  uint64_t capacity = 0;
+  size_t max_record_size = 0;
+};
+
+FlightRecorder::FlightRecorder(const std::string& path, size_t size)
+    : state_(std::make_shared<State>()) {
+  size = Align(std::max(size, kMinimumSize));
+  unique_fd fd(open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_BINARY, 0644));
+  if (fd == -1) return;
+
+  struct stat st;
+  if (fstat(fd.get(), &st) == -1) return;
+  if (static_cast<uint64_t>(st.st_size) != size) {
+#if defined(_WIN32)
+    if (_chsize_s(fd.get(), size) != 0) return;
+#else
+    if (ftruncate(fd.get(), size) == -1) return;
+#endif
+  }
+
+  std::unique_ptr<MappedFile> mapping = MappedFile::FromFd(fd, 0, size, PROT_READ | PROT_WRITE);
+  if (mapping == nullptr) return;
+
+  FileHeader* header = reinterpret_cast<FileHeader*>(mapping->data());
+  uint64_t capacity = size - sizeof(FileHeader);
+  if (header->magic != kFileMagic || header->version != kFileVersion ||
+      header->capacity != capacity) {
+    memset(mapping->data(), 0, size);
+    header->version = kFileVersion;
+    header->capacity = capacity;
+    header->head.store(0, std::memory_order_relaxed);
+    header->magic = kFileMagic;
+  }
+
+  state_->header = header;
+  state_->data = mapping->data() + sizeof(FileHeader);
+  state_->capacity = capacity;
+  state_->max_record_size = (capacity / 4) & ~(kAlignment - 1);
+  state_->mapping = std::move(mapping);
+}
+
+bool FlightRecorder::IsValid() const {
+  return state_->mapping != nullptr;
+}
+
+void FlightRecorder::operator()(LogId id, LogSeverity severity, const char* tag, const char* file,
+                                unsigned int line, const char* message) {
+  State* state = state_.get();
+  if (state->mapping == nullptr) return;
+
+  if (tag == nullptr) tag = "";
+  if (file == nullptr) file = "";
+  size_t tag_size = strnlen(tag, kMaxNameSize);
+  size_t file_size = strnlen(file, kMaxNameSize);
+  size_t message_size = strnlen(message, state->max_record_size - sizeof(RecordHeader) -
+                                             tag_size - file_size);
+  size_t record_size = Align(sizeof(RecordHeader) + tag_size + file_size + message_size);
+
+  // Reserve space for the record.
+  uint64_t capacity = state->capacity;
+  uint64_t head = state->header->head.load(std::memory_order_relaxed);
+  uint64_t position;
+  do {
+    uint64_t offset = head % capacity;
+    position = offset + record_size <= capacity ? head : head + (capacity - offset);
+  } while (!state->header->head.compare_exchange_weak(head, position + record_size,
+                                                      std::memory_order_relaxed));
+
+  RecordHeader* record = reinterpret_cast<RecordHeader*>(state->data + position % capacity);
+  // A reader must never mistake this for whatever used to be here while it's being written.
+  record->magic.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  RecordFields fields = {};
+  fields.position = position;
+  fields.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  fields.tid = GetThreadId();
+  fields.pid = getpid();
+  fields.line = line;
+  fields.message_size = message_size;
+  fields.tag_size = tag_size;
+  fields.file_size = file_size;
+  fields.id = id;
+  fields.severity = severity;
+  memcpy(&record->fields, &fields, sizeof(fields));
+
+  char* p = reinterpret_cast<char*>(record + 1);
+  memcpy(p, tag, tag_size);
+  memcpy(p + tag_size, file, file_size);
+  memcpy(p + tag_size + file_size, message, message_size);
+
+  uint32_t checksum = Checksum(kChecksumSeed, &fields, sizeof(fields));
+  record->checksum = Checksum(checksum, p, tag_size + file_size + message_size);
+  record->magic.store(kRecordMagic, std::memory_order_release);
+}
+
+// Returns the size of the record at `offset`, or 0 if there isn't a complete, current record
+// there.
+static size_t ReadRecord(const char* data, uint64_t capacity, uint64_t head, uint64_t offset,
+                         FlightRecord* result, uint64_t* position) {
+  const RecordHeader* record = reinterpret_cast<const RecordHeader*>(data + offset);
+  if (record->magic.load(std::memory_order_acquire) != kRecordMagic) return 0;
+
+  RecordFields fields;
+  memcpy(&fields, &record->fields, sizeof(fields));
+  if (fields.position % capacity != offset) return 0;
+  size_t payload_size = size_t(fields.tag_size) + fields.file_size + fields.message_size;
+  if (payload_size > capacity - offset - sizeof(RecordHeader)) return 0;
+  size_t record_size = Align(sizeof(RecordHeader) + payload_size);
+  // Not yet completely reserved, or since overwritten.
+  if (fields.position + record_size > head || fields.position + capacity < head) return 0;
+  if (fields.id > CRASH || fields.severity > FATAL) return 0;
+
+  const char* p = reinterpret_cast<const char*>(record + 1);
+  uint32_t checksum = Checksum(kChecksumSeed, &fields, sizeof(fields));
+  if (Checksum(checksum, p, payload_size) != record->checksum) return 0;
+
+  result->time = std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(fields.time_ns)));
+  result->pid = fields.pid;
+  result->tid = fields.tid;
+  result->id = static_cast<LogId>(fields.id);
+  result->severity = static_cast<LogSeverity>(fields.severity);
+  result->tag.assign(p, fields.tag_size);
+  result->file.assign(p + fields.tag_size, fields.file_size);
+  result->line = fields.line;
+  result->message.assign(p + fields.tag_size + fields.file_size, fields.message_size);
+  *position = fields.position;
+  return record_size;
+}
+
+bool ReadFlightRecorder(const std::string& path, size_t max_records,
+                        std::vector<FlightRecord>* records) {
+  records->clear();
+  unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC | O_BINARY));
+  if (fd == -1) return false;
+
+  struct stat st;
+  if (fstat(fd.get(), &st) == -1) return false;
+  if (static_cast<uint64_t>(st.st_size) < kMinimumSize) {
+    errno = EINVAL;
+    return false;
+  }
+  std::unique_ptr<MappedFile> mapping = MappedFile::FromFd(fd, 0, st.st_size, PROT_READ);
+  if (mapping == nullptr) return false;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping->data());
+  uint64_t capacity = header->capacity;
+  if (header->magic != kFileMagic || header->version != kFileVersion || capacity == 0 ||
+      capacity % kAlignment != 0 || capacity > st.st_size - sizeof(FileHeader)) {
+    errno = EINVAL;
+    return false;
+  }
+  uint64_t head = header->head.load(std::memory_order_acquire);
+  const char* data = mapping->data() + sizeof(FileHeader);
+
+  std::vector<std::pair<uint64_t, FlightRecord>> found;
+  FlightRecord record;
+  uint64_t position;
+  for (uint64_t offset = 0; offset + sizeof(RecordHeader) <= capacity;) {
+    size_t size = ReadRecord(data, capacity, head, offset, &record, &position);
+    if (size == 0) {
+      offset += kAlignment;
+      continue;
+    }
+    found.emplace_back(position, std::move(record));
+    offset += size;
+  }
+
+  std::sort(found.begin(), found.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  size_t skip = found.size() > max_records ? found.size() - max_records : 0;
+  records->reserve(found.size() - skip);
+  for (size_t i = skip; i < found.size(); ++i) {
+    records->push_back(std::move(found[i].second));
+  }
+  return true;
+}
+
+}  // namespace base
+}  // namespace android
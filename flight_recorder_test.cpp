@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/flight_recorder.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "android-base/file.h"
+#include "android-base/threads.h"
+
+using namespace android::base;
+
+TEST(flight_recorder, smoke) {
+  TemporaryFile tf;
+  FlightRecorder recorder(tf.path, 64 * 1024);
+  ASSERT_TRUE(recorder.IsValid());
+
+  auto before = std::chrono::system_clock::now();
+  recorder(MAIN, INFO, "tag", "file.cpp", 42, "first");
+  recorder(SYSTEM, ERROR, nullptr, nullptr, 0, "second\nline");
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 100, &records));
+  ASSERT_EQ(2U, records.size());
+  EXPECT_EQ(MAIN, records[0].id);
+  EXPECT_EQ(INFO, records[0].severity);
+  EXPECT_EQ("tag", records[0].tag);
+  EXPECT_EQ("file.cpp", records[0].file);
+  EXPECT_EQ(42U, records[0].line);
+  EXPECT_EQ("first", records[0].message);
+  EXPECT_EQ(getpid(), records[0].pid);
+  EXPECT_EQ(GetThreadId(), records[0].tid);
+  EXPECT_GE(records[0].time, before);
+
+  EXPECT_EQ(SYSTEM, records[1].id);
+  EXPECT_EQ(ERROR, records[1].severity);
+  EXPECT_EQ("", records[1].tag);
+  EXPECT_EQ("", records[1].file);
+  EXPECT_EQ("second\nline", records[1].message);
+}
+
+TEST(flight_recorder, every_log_id) {
+  TemporaryFile tf;
+  FlightRecorder recorder(tf.path, 64 * 1024);
+  ASSERT_TRUE(recorder.IsValid());
+
+  const LogId kIds[] = {DEFAULT, MAIN, SYSTEM, RADIO, CRASH};
+  for (LogId id : kIds) {
+    recorder(id, WARNING, "tag", nullptr, 0, std::to_string(id).c_str());
+  }
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 100, &records));
+  ASSERT_EQ(std::size(kIds), records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(kIds[i], records[i].id);
+    EXPECT_EQ(std::to_string(kIds[i]), records[i].message);
+  }
+}
+
+TEST(flight_recorder, wraps_around) {
+  TemporaryFile tf;
+  FlightRecorder recorder(tf.path, 4096);
+  for (int i = 0; i < 1000; ++i) {
+    recorder(MAIN, VERBOSE, "tag", __FILE__, __LINE__, std::to_string(i).c_str());
+  }
+
+  // Only the most recent records fit, and they must be consecutive.
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 1000, &records));
+  ASSERT_GT(records.size(), 10U);
+  ASSERT_LT(records.size(), 100U);
+  int first = 1000 - records.size();
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(std::to_string(first + i), records[i].message);
+  }
+
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 3, &records));
+  ASSERT_EQ(3U, records.size());
+  EXPECT_EQ("997", records[0].message);
+  EXPECT_EQ("999", records[2].message);
+}
+
+TEST(flight_recorder, truncates_long_messages) {
+  TemporaryFile tf;
+  FlightRecorder recorder(tf.path, 4096);
+  std::string long_message(10000, 'x');
+  recorder(MAIN, INFO, "tag", "file.cpp", 1, long_message.c_str());
+  recorder(MAIN, INFO, "tag", "file.cpp", 2, "after");
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 10, &records));
+  ASSERT_EQ(2U, records.size());
+  EXPECT_LT(records[0].message.size(), 1024U);
+  EXPECT_EQ(std::string(records[0].message.size(), 'x'), records[0].message);
+  EXPECT_EQ("after", records[1].message);
+}
+
+TEST(flight_recorder, survives_crash) {
+  TemporaryFile tf;
+  std::string path = tf.path;
+  ASSERT_DEATH(
+      {
+        FlightRecorder recorder(path, 64 * 1024);
+        recorder(MAIN, VERBOSE, "tag", "file.cpp", 1, "before the crash");
+        abort();
+      },
+      "");
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(path, 10, &records));
+  ASSERT_EQ(1U, records.size());
+  EXPECT_EQ("before the crash", records[0].message);
+  EXPECT_NE(getpid(), records[0].pid);
+
+  // A new recorder keeps what was there.
+  FlightRecorder recorder(path, 64 * 1024);
+  recorder(MAIN, INFO, "tag", "file.cpp", 2, "after the crash");
+  ASSERT_TRUE(ReadFlightRecorder(path, 10, &records));
+  ASSERT_EQ(2U, records.size());
+  EXPECT_EQ("before the crash", records[0].message);
+  EXPECT_EQ("after the crash", records[1].message);
+}
+
+TEST(flight_recorder, skips_corrupt_records) {
+  TemporaryFile tf;
+  {
+    FlightRecorder recorder(tf.path, 4096);
+    recorder(MAIN, INFO, "tag", "file.cpp", 1, "first");
+    recorder(MAIN, INFO, "tag", "file.cpp", 2, "second");
+    recorder(MAIN, INFO, "tag", "file.cpp", 3, "third");
+  }
+
+  // Flip a byte of the second message, as if it had been torn by a crash.
+  std::string contents;
+  ASSERT_TRUE(ReadFileToString(tf.path, &contents));
+  size_t offset = contents.find("second");
+  ASSERT_NE(std::string::npos, offset);
+  contents[offset] = 'S';
+  ASSERT_TRUE(WriteStringToFile(contents, tf.path));
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 10, &records));
+  ASSERT_EQ(2U, records.size());
+  EXPECT_EQ("first", records[0].message);
+  EXPECT_EQ("third", records[1].message);
+}
+
+TEST(flight_recorder, threads) {
+  TemporaryFile tf;
+  FlightRecorder recorder(tf.path, 1024 * 1024);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&recorder, i] {
+      for (int j = 0; j < 1000; ++j) {
+        recorder(MAIN, INFO, "tag", "file.cpp", i, std::to_string(j).c_str());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::vector<FlightRecord> records;
+  ASSERT_TRUE(ReadFlightRecorder(tf.path, 10000, &records));
+  ASSERT_EQ(4000U, records.size());
+  int next[4] = {};
+  for (const auto& record : records) {
+    ASSERT_LT(record.line, 4U);
+    EXPECT_EQ(std::to_string(next[record.line]++), record.message);
+  }
+}
+
+TEST(flight_recorder, not_a_flight_recorder) {
+  TemporaryFile tf;
+  ASSERT_TRUE(WriteStringToFile(std::string(8192, 'x'), tf.path));
+  std::vector<FlightRecord> records;
+  errno = 0;
+  EXPECT_FALSE(ReadFlightRecorder(tf.path, 10, &records));
+  EXPECT_EQ(EINVAL, errno);
+
+  errno = 0;
+  EXPECT_FALSE(ReadFlightRecorder("/does/not/exist", 10, &records));
+  EXPECT_EQ(ENOENT, errno);
+}
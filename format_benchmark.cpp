@@ -17,9 +17,12 @@
 #include "android-base/format.h"
 
 #include <limits>
+#include <string>
 
 #include <benchmark/benchmark.h>
 
+#include "android-base/format_logging.h"
+#include "android-base/logging.h"
 #include "android-base/stringprintf.h"
 
 using android::base::StringPrintf;
@@ -76,5 +79,34 @@ static void BenchmarkStringPrintfStrings(benchmark::State& state) {
 
 BENCHMARK(BenchmarkStringPrintfStrings);
 
+static void DiscardingLogger(android::base::LogId, android::base::LogSeverity, const char*,
+                             const char*, unsigned int, const char* message) {
+  benchmark::DoNotOptimize(message);
+}
+
+static void BenchmarkLogStream(benchmark::State& state) {
+  auto old_logger = android::base::SetLogger(DiscardingLogger);
+  std::string peer = "192.168.0.1:5555";
+  for (auto _ : state) {
+    LOG(INFO) << "request " << 42 << " took " << 3.25 << "ms from " << peer << " ("
+              << std::numeric_limits<int64_t>::max() << " bytes)";
+  }
+  android::base::SetLogger(std::move(old_logger));
+}
+
+BENCHMARK(BenchmarkLogStream);
+
+static void BenchmarkLogFormat(benchmark::State& state) {
+  auto old_logger = android::base::SetLogger(DiscardingLogger);
+  std::string peer = "192.168.0.1:5555";
+  for (auto _ : state) {
+    LOGF(INFO, "request {} took {}ms from {} ({} bytes)", 42, 3.25, peer,
+         std::numeric_limits<int64_t>::max());
+  }
+  android::base::SetLogger(std::move(old_logger));
+}
+
+BENCHMARK(BenchmarkLogFormat);
+
 // Run the benchmark
 BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/format_logging.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "recording_logger.h"
+
+using android::base::LogSeverity;
+
+TEST(format_logging, LOGF) {
+  ScopedRecordingLogger logger;
+  LOGF(WARNING, "{} {} {:.2f} {:#x} {}", 1, "two", 3.5, 255u, std::string("five"));
+  EXPECT_EQ(std::vector<std::string>{"1 two 3.50 0xff five"}, logger.Messages());
+  EXPECT_EQ(std::vector<std::string>{"format_logging_test.cpp"}, logger.Files());
+  EXPECT_EQ(std::vector<LogSeverity>{android::base::WARNING}, logger.Severities());
+}
+
+TEST(format_logging, LOGF_no_arguments) {
+  ScopedRecordingLogger logger;
+  LOGF(INFO, "no arguments");
+  EXPECT_EQ(std::vector<std::string>{"no arguments"}, logger.Messages());
+}
+
+TEST(format_logging, LOGF_disabled_does_not_evaluate_arguments) {
+  ScopedRecordingLogger logger;
+  android::base::ScopedLogSeverity sls(android::base::WARNING);
+  int evaluated = 0;
+  LOGF(INFO, "{}", ++evaluated);
+  EXPECT_EQ(0, evaluated);
+  EXPECT_TRUE(logger.Messages().empty());
+}
+
+TEST(format_logging, LOGF_long_message) {
+  ScopedRecordingLogger logger;
+  std::string big(100000, 'x');
+  LOGF(INFO, "{}", big);
+  LOGF(INFO, "{}", "short");
+  EXPECT_EQ((std::vector<std::string>{big, "short"}), logger.Messages());
+}
+
+namespace {
+
+struct LogsWhenFormatted {};
+
+}  // namespace
+
+template <>
+struct fmt::formatter<LogsWhenFormatted> : fmt::formatter<std::string_view> {
+  template <typename FormatContext>
+  auto format(const LogsWhenFormatted&, FormatContext& ctx) const -> decltype(ctx.out()) {
+    LOGF(INFO, "inner {}", 1);
+    return fmt::formatter<std::string_view>::format("formatted", ctx);
+  }
+};
+
+TEST(format_logging, LOGF_nested) {
+  ScopedRecordingLogger logger;
+  LOGF(INFO, "outer {} {}", LogsWhenFormatted(), 2);
+  EXPECT_EQ((std::vector<std::string>{"inner 1", "outer formatted 2"}), logger.Messages());
+}
+
+TEST(format_logging, PLOGF) {
+  ScopedRecordingLogger logger;
+  errno = ENOENT;
+  // Arguments that change errno don't affect the logged error.
+  LOGF(INFO, "unrelated");
+  PLOGF(ERROR, "open {} failed", (errno = EINTR, "/some/path"));
+  EXPECT_EQ(ENOENT, errno);
+  ASSERT_EQ(2U, logger.Messages().size());
+  EXPECT_EQ(std::string("open /some/path failed: ") + strerror(ENOENT), logger.Messages()[1]);
+}
+
+TEST(format_logging, CHECKF) {
+  int evaluated = 0;
+  CHECKF(true, "{}", ++evaluated);
+  EXPECT_EQ(0, evaluated);
+  ASSERT_DEATH(CHECKF(1 == 2, "{} != {}", 1, 2), "Check failed: 1 == 2 1 != 2");
+}
+
+TEST(format_logging, LOGF_FATAL) {
+  ASSERT_DEATH(LOGF(FATAL, "fatal {}", 42), "fatal 42");
+}
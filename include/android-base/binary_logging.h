@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// Logging with deferred formatting.
+//
+
+// To log:
+//
+//   LOGB(INFO, "request {} took {}us", request_id, elapsed_us);
+//
+// LOGB checks its format string at compile time (like Errorf in result.h), but doesn't format
+// anything on the calling thread. It copies the address of the format string and the raw bytes of
+// the arguments into a lock-free queue, and a background thread formats the message later and
+// hands it to LogMessage::LogLine (and so to the current logger). This makes a LOGB call cheap
+// enough for high-frequency tracing.
+//
+// The arguments must be arithmetic types, enums, non-char pointers, or strings (const char*,
+// std::string or std::string_view). Strings are copied, so they needn't outlive the call, and
+// can't be formatted as pointers with {:p}. A message whose arguments don't fit in a queue slot is
+// formatted immediately instead.
+//
+// Because formatting is deferred, a LOGB message can reach the logger after a LOG message that was
+// logged later on the same thread. FATAL and FATAL_WITHOUT_ABORT messages are formatted
+// immediately, after every pending LOGB message has been written; LOG(FATAL) also writes pending
+// LOGB messages first, so they are never lost to an abort.
+
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "android-base/format.h"
+#include "android-base/logging.h"
+
+namespace android {
+namespace base {
+
+namespace log_detail {
+
+// The space available for a message's encoded arguments.
+static constexpr size_t kBinaryLogArgsSize = 224;
+
+// Formats the arguments encoded in `args` according to `format`, appending to `out`.
+using BinaryLogDecoder = void (*)(fmt::memory_buffer& out, fmt::string_view format,
+                                  const char* args);
+
+// Encoding and decoding of trivially copyable arguments: their bytes are copied as is.
+template <typename T>
+struct BinaryLogArg {
+  static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+                "LOGB arguments must be arithmetic, enums, pointers or strings");
+  using Decoded = T;
+
+  static size_t Size(const T&) { return sizeof(T); }
+
+  static char* Encode(char* p, const T& value) {
+    memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+  }
+
+  static T Decode(const char*& p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+  }
+};
+
+// Strings are encoded as their length followed by their bytes, and decoded as views of the
+// encoded bytes.
+struct BinaryLogStringArg {
+  using Decoded = fmt::string_view;
+
+  static size_t Size(std::string_view s) { return sizeof(size_t) + s.size(); }
+
+  static char* Encode(char* p, std::string_view s) {
+    size_t size = s.size();
+    memcpy(p, &size, sizeof(size));
+    memcpy(p + sizeof(size), s.data(), size);
+    return p + sizeof(size) + size;
+  }
+
+  static fmt::string_view Decode(const char*& p) {
+    size_t size;
+    memcpy(&size, p, sizeof(size));
+    fmt::string_view s(p + sizeof(size), size);
+    p += sizeof(size) + size;
+    return s;
+  }
+};
+
+template <>
+struct BinaryLogArg<const char*> : BinaryLogStringArg {
+  static std::string_view View(const char* s) { return s != nullptr ? s : "(null)"; }
+  static size_t Size(const char* s) { return BinaryLogStringArg::Size(View(s)); }
+  static char* Encode(char* p, const char* s) { return BinaryLogStringArg::Encode(p, View(s)); }
+};
+template <>
+struct BinaryLogArg<char*> : BinaryLogArg<const char*> {};
+template <>
+struct BinaryLogArg<std::string> : BinaryLogStringArg {};
+template <>
+struct BinaryLogArg<std::string_view> : BinaryLogStringArg {};
+
+template <typename... Args>
+void DecodeBinaryLog(fmt::memory_buffer& out, fmt::string_view format,
+                     [[maybe_unused]] const char* args) {
+  // Braced initialization guarantees that the arguments are decoded left to right.
+  std::tuple<typename BinaryLogArg<Args>::Decoded...> values{BinaryLogArg<Args>::Decode(args)...};
+  std::apply(
+      [&](const auto&... values) {
+        fmt::vformat_to(std::back_inserter(out), format, fmt::make_format_args(values...));
+      },
+      values);
+}
+
+}  // namespace log_detail
+
+// Queues an encoded LOGB message. Use LOGB rather than calling this directly.
+LIBBASE_EXPORT void LogBinary(const char* file, unsigned int line, LogSeverity severity,
+                              const char* tag, log_detail::BinaryLogDecoder decoder,
+                              fmt::string_view format, const char* args, size_t args_size);
+
+// Blocks until every LOGB message queued so far has been passed to LogMessage::LogLine.
+LIBBASE_EXPORT void FlushBinaryLogs();
+
+// Implementation of LOGB. Note: DO NOT USE DIRECTLY.
+template <typename S, typename... Args>
+bool LogBinaryImpl(const char* file, unsigned int line, LogSeverity severity, const char* tag,
+                   const S& format, const Args&... args) {
+  // Constructing a format_string from FMT_STRING checks the arguments at compile time. The format
+  // is also checked against the types the arguments are decoded as, since a string formatted with
+  // {:p} would otherwise only fail once it's been copied, on the background thread.
+  fmt::format_string<const Args&...> checked_format(format);
+  [[maybe_unused]] fmt::format_string<
+      const typename log_detail::BinaryLogArg<std::decay_t<Args>>::Decoded&...>
+      checked_decoded_format(format);
+
+  size_t args_size = (size_t{0} + ... + log_detail::BinaryLogArg<std::decay_t<Args>>::Size(args));
+  if (severity >= FATAL_WITHOUT_ABORT || args_size > log_detail::kBinaryLogArgsSize) {
+    FlushBinaryLogs();
+    LogMessage(file, line, severity, tag, -1).stream() << fmt::format(checked_format, args...);
+    return true;
+  }
+
+  char encoded[log_detail::kBinaryLogArgsSize];
+  [[maybe_unused]] char* p = encoded;
+  ((p = log_detail::BinaryLogArg<std::decay_t<Args>>::Encode(p, args)), ...);
+  LogBinary(file, line, severity, tag, &log_detail::DecodeBinaryLog<std::decay_t<Args>...>,
+            fmt::string_view(format), encoded, args_size);
+  return true;
+}
+
+// Logs a message formatted with fmtlib, deferring the formatting to a background thread. For
+// example:
+//
+//     LOGB(INFO, "{} bytes from {}", size, peer_name);
+#define LOGB(severity, fmt, ...)                                                               \
+  LOGGING_PREAMBLE(severity) &&                                                                \
+      ::android::base::LogBinaryImpl(__FILE__, __LINE__, SEVERITY_LAMBDA(severity),            \
+                                     _LOG_TAG_INTERNAL, FMT_STRING(fmt), ##__VA_ARGS__)
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// A crash-safe in-memory log.
+//
+
+// To record everything, and only write it out when something goes wrong:
+//
+//   FlightRecorder recorder("/data/local/tmp/foo.flight", 1024 * 1024);
+//   SetLogger(recorder);
+//   SetMinimumLogSeverity(VERBOSE);
+//   ...
+//   std::vector<FlightRecord> records;
+//   ReadFlightRecorder("/data/local/tmp/foo.flight", 100, &records);
+//
+// The FlightRecorder keeps the most recent messages in a circular buffer in a shared mapping of a
+// file (see MappedFile), so logging a message is a memcpy into memory with no system call. The
+// kernel owns the mapped pages, so the messages outlive the process: if it crashes or aborts, the
+// file still holds everything up to the crash, and ReadFlightRecorder can reconstruct the last
+// records from it afterwards (or from another process, or in an aborter before it aborts). The
+// file only survives a crash of the kernel if the pages were written back before it.
+//
+// Each record is checksummed, so a message that was being written when the process died, or
+// that was overwritten while it was being read, is skipped rather than returned corrupted.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "android-base/logging.h"
+
+#include <android-base\libbase_export.h>
+
+namespace android {
+namespace base {
+
+// A message read back from a flight recorder file.
+struct FlightRecord {
+  std::chrono::system_clock::time_point time;
+  int pid;
+  uint64_t tid;
+  LogId id;
+  LogSeverity severity;
+  std::string tag;
+  std::string file;
+  unsigned int line;
+  std::string message;
+};
+
+// A LogFunction that records messages into a fixed-size, file-backed circular buffer, overwriting
+// the oldest once it's full.  Logging is lock-free.  Messages longer than a quarter of the buffer
+// are truncated.
+class LIBBASE_EXPORT FlightRecorder {
+ public:
+  // Maps `path` (created if necessary) as a buffer of `size` bytes.  If the file already holds a
+  // buffer of that size, for example from before a crash, its records are kept and new ones are
+  // appended after them.  If the file can't be mapped, messages are discarded.
+  FlightRecorder(const std::string& path, size_t size);
+
+  void operator()(LogId, LogSeverity, const char* tag, const char* file, unsigned int line,
+                  const char* message);
+
+  // Returns false if the file couldn't be mapped.
+  bool IsValid() const;
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+// Reads up to `max_records` of the most recent records from a file written by a FlightRecorder,
+// oldest first.  Returns false (with errno set) if the file can't be read or isn't a flight
+// recorder file.
+LIBBASE_EXPORT bool ReadFlightRecorder(const std::string& path, size_t max_records,
+                                       std::vector<FlightRecord>* records);
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// Logging with fmtlib format strings.
+//
+
+// To log:
+//
+//   LOGF(INFO, "request {} took {}us", request_id, elapsed_us);
+//   PLOGF(ERROR, "open {} failed", path);
+//   CHECKF(fd != -1, "no fd for {}", path);
+//
+// These behave like LOG, PLOG and CHECK, but take a format string rather than a stream. The format
+// string is checked against the arguments at compile time (like Errorf in result.h), and the
+// message is formatted into a buffer owned by the calling thread rather than through an
+// std::ostream, so it's faster, independent of the locale, and doesn't allocate once the thread
+// has logged a message of similar size.
+
+#include <string_view>
+
+#include "android-base/format.h"
+#include "android-base/logging.h"
+
+namespace android {
+namespace base {
+
+namespace log_detail {
+
+// Formats and logs a message, aborting afterwards if severity is FATAL. `prefix` is logged before
+// the formatted message, and, unless `error` is -1, ": " followed by strerror(error) after it.
+LIBBASE_EXPORT void LogFormatted(const char* file, unsigned int line, LogSeverity severity,
+                                 const char* tag, int error, std::string_view prefix,
+                                 fmt::string_view format, fmt::format_args args);
+
+}  // namespace log_detail
+
+// Implementation of LOGF, PLOGF and CHECKF. Note: DO NOT USE DIRECTLY.
+template <typename S, typename... Args>
+bool LogFormattedImpl(const char* file, unsigned int line, LogSeverity severity, const char* tag,
+                      int error, std::string_view prefix, const S& format, const Args&... args) {
+  // Constructing a format_string from FMT_STRING checks the arguments at compile time.
+  fmt::format_string<const Args&...> checked_format(format);
+  log_detail::LogFormatted(file, line, severity, tag, error, prefix, checked_format,
+                           fmt::make_format_args(args...));
+  return true;
+}
+
+// Logs a message formatted with fmtlib. If the severity is FATAL it also causes an abort. For
+// example:
+//
+//     LOGF(WARNING, "{} bytes from {}", size, peer_name);
+#define LOGF(severity, fmt, ...)                                                          \
+  LOGGING_PREAMBLE(severity) &&                                                           \
+      ::android::base::LogFormattedImpl(__FILE__, __LINE__, SEVERITY_LAMBDA(severity),    \
+                                        _LOG_TAG_INTERNAL, -1, std::string_view(),        \
+                                        FMT_STRING(fmt), ##__VA_ARGS__)
+
+// A variant of LOGF that also logs the current errno value. errno is read before the arguments are
+// evaluated, so they can't clobber it.
+#define PLOGF(severity, fmt, ...)                                                              \
+  LOGGING_PREAMBLE(severity) && [&](int _error) {                                              \
+    return ::android::base::LogFormattedImpl(__FILE__, __LINE__, SEVERITY_LAMBDA(severity),    \
+                                             _LOG_TAG_INTERNAL, _error, std::string_view(),    \
+                                             FMT_STRING(fmt), ##__VA_ARGS__);                  \
+  }(errno)
+
+// Check whether condition x holds and LOGF(FATAL) if not. The value of the expression x is only
+// evaluated once, and the arguments only if it's false. For example:
+//
+//     CHECKF(fd != -1, "no fd for {}", path) results in a log message of
+//       "Check failed: fd != -1 no fd for /some/path".
+#define CHECKF(x, fmt, ...)                                                                     \
+  (void)(LIKELY((x)) || ABORT_AFTER_LOG_FATAL_EXPR(false) ||                                    \
+         ::android::base::LogFormattedImpl(__FILE__, __LINE__, ::android::base::FATAL,          \
+                                           _LOG_TAG_INTERNAL, -1, "Check failed: " #x " ",      \
+                                           FMT_STRING(fmt), ##__VA_ARGS__))
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// Statistics about logging itself.
+//
+
+// To log a summary of what has been logged:
+//
+//   SetLogStatisticsEnabled(true);
+//   ...
+//   LOG(INFO) << FormatLogStatistics(GetLogStatistics());
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "android-base/logging.h"
+
+namespace android {
+namespace base {
+
+// Statistics about logging itself, to find the call sites worth demoting or sampling.  Nothing is
+// collected until SetLogStatisticsEnabled(true) is called; until then, the only cost is a relaxed
+// atomic load per message.
+struct LogStatistics {
+  struct Counters {
+    // Messages passed to the logger.
+    uint64_t emitted = 0;
+    // Calls to ShouldLog() that returned false (so LOG statements that were filtered out).
+    uint64_t suppressed = 0;
+    // Bytes of message text passed to the logger.
+    uint64_t bytes = 0;
+  };
+
+  static constexpr size_t kLatencyBuckets = 32;
+
+  Counters severities[FATAL + 1];
+  // Keyed by tag; the default tag (a null tag) is counted as "".  Only the first kMaxTags tags seen
+  // get counters of their own, the rest are counted together as "(other)".
+  static constexpr size_t kMaxTags = 1024;
+  std::map<std::string, Counters> tags;
+  // latency[severity][i] counts the LOG, PLOG, CHECK and LOGF messages whose LogMessage destructor
+  // (or LOGF call) took from 2^i to 2^(i+1) - 1 nanoseconds.  The last bucket also counts anything
+  // slower.
+  uint64_t latency[FATAL + 1][kLatencyBuckets] = {};
+};
+
+// Starts or stops collecting log statistics.  Stopping keeps the statistics collected so far.
+LIBBASE_EXPORT void SetLogStatisticsEnabled(bool enabled);
+
+// Returns the statistics collected so far.  The counters are read one at a time while other
+// threads may be logging, so they aren't an atomic snapshot.
+LIBBASE_EXPORT LogStatistics GetLogStatistics();
+
+// Zeroes the statistics, and forgets every tag, so that tags seen afterwards get counters of their
+// own again.  A message logged while this runs may or may not be counted.
+LIBBASE_EXPORT void ResetLogStatistics();
+
+// Formats statistics as a human-readable table: the counters for each severity with latency
+// percentiles, then the tags in decreasing order of bytes logged.
+LIBBASE_EXPORT std::string FormatLogStatistics(const LogStatistics& statistics);
+
+// Calls `dump` on a background thread every `interval` with the statistics collected so far, or,
+// if `dump` is null, logs them with FormatLogStatistics() at INFO.  An interval of zero stops the
+// dumps.  This waits for any dump in progress to finish, so it mustn't be called from `dump`.
+LIBBASE_EXPORT void SetLogStatisticsDumpInterval(
+    std::chrono::milliseconds interval,
+    std::function<void(const LogStatistics& statistics)> dump = nullptr);
+
+}  // namespace base
+}  // namespace android
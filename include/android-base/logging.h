@@ -62,9 +62,18 @@
 #endif
 #endif
 
+#include <stdint.h>
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "android-base/errno_restorer.h"
 #include "android-base/macros.h"
@@ -116,6 +125,17 @@ using AbortFunction = std::function<void(const char* /*abort_message*/)>;
 LIBBASE_EXPORT void KernelLogger(LogId log_buffer_id, LogSeverity severity, const char* tag, const char* file, unsigned int line, const char* message);
 // Log to stderr in the full logcat format (with pid/tid/time/tag details).
 LIBBASE_EXPORT void StderrLogger(LogId log_buffer_id, LogSeverity severity, const char* tag, const char* file, unsigned int line, const char* message);
+
+// The timestamp at the start of each line that StderrLogger writes.
+enum class LogTimestampFormat {
+  kSeconds,       // "01-31 23:59:59", the default.
+  kMilliseconds,  // "01-31 23:59:59.999"
+  kMicroseconds,  // "01-31 23:59:59.999999"
+};
+
+// Set the format of StderrLogger's timestamps, returning the old format.
+LIBBASE_EXPORT LogTimestampFormat SetStderrLogTimestampFormat(LogTimestampFormat format);
+
 // Log just the message to stdout/stderr (without pid/tid/time/tag details).
 // The choice of stdout versus stderr is based on the severity.
 // Errors are also prefixed by the program name (as with err(3)/error(3)).
@@ -141,6 +161,92 @@ class LIBBASE_EXPORT LogdLogger {
   LogId default_log_id_;
 };
 
+// The AsyncLogger moves the cost of writing log messages off the logging thread.  Each message is
+// copied into a bounded lock-free queue and a dedicated writer thread passes it on to the wrapped
+// logger, so a slow destination (for example stderr connected to a slow pipe) no longer stalls the
+// threads that log.
+//
+// FATAL and FATAL_WITHOUT_ABORT messages are written synchronously: every message queued before
+// them is drained, then the message itself is written, all before the logger returns.  This
+// guarantees that nothing is lost when the aborter runs.
+//
+// The writer thread does not survive fork(), so a child process should install a synchronous
+// logger before it logs anything.
+class LIBBASE_EXPORT AsyncLogger {
+ public:
+  // What to do when a message is logged while the queue is full.
+  enum class OverflowPolicy {
+    kBlock,       // Wait for the writer thread to make room.
+    kDropOldest,  // Discard the oldest queued message to make room.
+    kDropNewest,  // Discard the message being logged.
+  };
+
+  // `capacity` is rounded up to the next power of two.
+  explicit AsyncLogger(LogFunction&& logger, size_t capacity = 1024,
+                       OverflowPolicy policy = OverflowPolicy::kBlock);
+
+  void operator()(LogId, LogSeverity, const char* tag, const char* file, unsigned int line,
+                  const char* message);
+
+  // Blocks until every message queued so far has been passed to the wrapped logger.
+  void Flush();
+
+  // Returns the number of messages discarded because the queue was full.  The writer thread also
+  // reports new drops as a WARNING ahead of the next message it writes.
+  uint64_t GetDroppedCount() const;
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+// The FileLogger appends messages to a file, in the same format as StderrLogger, and rotates the
+// file when it gets too big or at fixed intervals.  Messages are buffered and written in large
+// batches: when the buffer fills, at least every `flush_interval`, and immediately for ERROR and
+// above (so nothing is lost to an abort).  Rotated files are renamed to "<path>.<timestamp>" and
+// handed to a background thread, which passes them to the `compress` hook and deletes the oldest.
+//
+// If the file can't be opened or written, messages go to stderr instead.  The background thread
+// does not survive fork(), so a child process should install another logger.
+class LIBBASE_EXPORT FileLogger {
+ public:
+  struct Options {
+    // Rotate before the file would grow beyond this many bytes (0 for no limit).
+    uint64_t max_file_size = 16 * 1024 * 1024;
+    // Also rotate at every multiple of this interval since the epoch (0 for never), so that for
+    // example std::chrono::hours(24) rotates at midnight UTC.
+    std::chrono::seconds rotation_interval{0};
+    // Delete the oldest rotated files beyond this many (0 for no limit).  Only files rotated by
+    // this logger count.
+    size_t max_rotated_files = 5;
+    // Write buffered messages once there are this many bytes of them...
+    size_t buffer_size = 64 * 1024;
+    // ...or once they're this old (0 to only write when the buffer fills).
+    std::chrono::milliseconds flush_interval{1000};
+    // Reserve this much disk space for each new file up front, to reduce fragmentation (0 for
+    // none).  Only supported on Linux.
+    uint64_t preallocate_size = 0;
+    // If set, called on the background thread with the path of each rotated file, for example to
+    // compress it.  Returns the path of the resulting file (such as `path + ".gz"`), which is the
+    // one that will eventually be deleted.
+    std::function<std::string(const std::string& path)> compress;
+  };
+
+  explicit FileLogger(const std::string& path);
+  FileLogger(const std::string& path, const Options& options);
+
+  void operator()(LogId, LogSeverity, const char* tag, const char* file, unsigned int line,
+                  const char* message);
+
+  // Writes any buffered messages to the file, and blocks until the background thread has finished
+  // with every file rotated so far.
+  void Flush();
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
 // Configure logging based on ANDROID_LOG_TAGS environment variable.
 // We need to parse a string that looks like
 //
@@ -148,7 +254,8 @@ class LIBBASE_EXPORT LogdLogger {
 //
 // The tag (or '*' for the global level) comes first, followed by a colon and a
 // letter indicating the minimum priority level we're expected to log.  This can
-// be used to reveal or conceal logs with specific tags.
+// be used to reveal or conceal logs with specific tags.  A tag without a level
+// is logged at every level.
 #ifdef __ANDROID__
 #define INIT_LOGGING_DEFAULT_LOGGER LogdLogger()
 #else
@@ -200,8 +307,9 @@ struct LogAbortAfterFullExpr {
 #define ABORT_AFTER_LOG_FATAL_EXPR(x) ABORT_AFTER_LOG_EXPR_IF(true, x)
 
 // Defines whether the given severity will be logged or silently swallowed.
-#define WOULD_LOG(severity)                                                              \
-  (UNLIKELY(::android::base::ShouldLog(SEVERITY_LAMBDA(severity), _LOG_TAG_INTERNAL)) || \
+#define WOULD_LOG(severity)                                                                  \
+  (UNLIKELY(LOG_CALL_SITE_STATE(::android::base::log_detail::TagSeverityCache)               \
+                .ShouldLog(SEVERITY_LAMBDA(severity), _LOG_TAG_INTERNAL)) ||                 \
    MUST_LOG_MESSAGE(severity))
 
 // Get an ostream that can be used for logging at the given severity and to the default
@@ -238,6 +346,47 @@ struct LogAbortAfterFullExpr {
                                   _LOG_TAG_INTERNAL, errno)                      \
           .stream()
 
+// Variants of LOG that only log some of the times they're reached, to keep a hot error path from
+// flooding the log. Each logged message starts with the number of messages the statement has
+// suppressed since it last logged, if any. A suppressed message costs a relaxed atomic (plus a
+// clock read for LOG_EVERY_T) and is never formatted. Messages below the minimum severity aren't
+// counted.
+
+// Logs the 1st, (n+1)th, (2n+1)th... time it's reached. For example:
+//
+//     LOG_EVERY_N(WARNING, 100) << "dropped packet from " << peer;
+#define LOG_EVERY_N(severity, n)                                                       \
+  LOGGING_PREAMBLE(severity) &&                                                        \
+      LOG_CALL_SITE_STATE(::android::base::log_detail::LogEveryNState).ShouldLog(n) && \
+      LOG_STREAM(severity) << ::android::base::log_detail::LogSuppressedCount()
+
+// Logs only the first n times it's reached.
+#define LOG_FIRST_N(severity, n)                                                       \
+  LOGGING_PREAMBLE(severity) &&                                                        \
+      LOG_CALL_SITE_STATE(::android::base::log_detail::LogFirstNState).ShouldLog(n) && \
+      LOG_STREAM(severity)
+
+// Logs at most once per `period` (a std::chrono::duration), measured with boot_clock.
+#define LOG_EVERY_T(severity, period)                                                       \
+  LOGGING_PREAMBLE(severity) &&                                                             \
+      LOG_CALL_SITE_STATE(::android::base::log_detail::LogEveryTState).ShouldLog(period) && \
+      LOG_STREAM(severity) << ::android::base::log_detail::LogSuppressedCount()
+
+// Logs each time it's reached with the given probability (between 0 and 1).
+#define LOG_SAMPLED(severity, probability)                                                   \
+  LOGGING_PREAMBLE(severity) &&                                                              \
+      LOG_CALL_SITE_STATE(::android::base::log_detail::LogSampledState)                      \
+          .ShouldLog(probability) &&                                                         \
+      LOG_STREAM(severity) << ::android::base::log_detail::LogSuppressedCount()
+
+// A static object of the given type, unique to the call site.
+// Note: DO NOT USE DIRECTLY. This is an implementation detail.
+#define LOG_CALL_SITE_STATE(type) \
+  ([]() -> type& {                \
+    static type state;            \
+    return state;                 \
+  }())
+
 // Marker that code is yet to be implemented.
 #define UNIMPLEMENTED(level) \
   LOG(level) << __PRETTY_FUNCTION__ << " unimplemented "
@@ -386,6 +535,80 @@ struct EagerEvaluator {
   const Storage<typename StorageTypes<LHS, RHS>::RHSType> rhs;
 };
 
+// Records the number of messages suppressed by a rate-limited logging statement that is about to
+// log, for LogSuppressedCount to report.
+LIBBASE_EXPORT void SetLogSuppressedCount(uint64_t count);
+
+// Writes "(N suppressed) " for the count given to SetLogSuppressedCount on this thread (nothing if
+// it's 0), and resets it.
+struct LogSuppressedCount {};
+LIBBASE_EXPORT std::ostream& operator<<(std::ostream& os, LogSuppressedCount);
+
+// Call-site state for WOULD_LOG.  A call site's tag is almost always the same LOG_TAG literal (or
+// null), so the minimum severity of the tag it last saw is cached until the per-tag severities next
+// change, and the common case costs a few loads rather than a lookup.  A LOG_TAG that isn't a
+// literal just misses whenever it changes.  Otherwise the same as ShouldLog().
+class LIBBASE_EXPORT TagSeverityCache {
+ public:
+  bool ShouldLog(LogSeverity severity, const char* tag);
+
+ private:
+  // A seqlock over tag_ and cached_: odd while a thread is updating them.
+  std::atomic<uint32_t> sequence_{0};
+  // The tag that cached_ is for.
+  std::atomic<const char*> tag_{nullptr};
+  // The generation of the per-tag severities that this is for, shifted left by 8, plus one more
+  // than the tag's minimum severity (0 if it has none).  0 until the first lookup.
+  std::atomic<uint64_t> cached_{0};
+};
+
+// Call-site state for LOG_EVERY_N.
+class LogEveryNState {
+ public:
+  bool ShouldLog(uint64_t n) {
+    uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (n > 1 && count % n != 0) return false;
+    SetLogSuppressedCount(count == 0 || n <= 1 ? 0 : n - 1);
+    return true;
+  }
+
+ private:
+  std::atomic<uint64_t> count_{0};
+};
+
+// Call-site state for LOG_FIRST_N.
+class LogFirstNState {
+ public:
+  bool ShouldLog(uint64_t n) {
+    // Stop incrementing once we're done, so the counter can't wrap.
+    return count_.load(std::memory_order_relaxed) < n &&
+           count_.fetch_add(1, std::memory_order_relaxed) < n;
+  }
+
+ private:
+  std::atomic<uint64_t> count_{0};
+};
+
+// Call-site state for LOG_EVERY_T.
+class LIBBASE_EXPORT LogEveryTState {
+ public:
+  bool ShouldLog(std::chrono::nanoseconds period);
+
+ private:
+  // The boot_clock time in nanoseconds at which the next message may be logged.
+  std::atomic<int64_t> next_{std::numeric_limits<int64_t>::min()};
+  std::atomic<uint64_t> suppressed_{0};
+};
+
+// Call-site state for LOG_SAMPLED.
+class LIBBASE_EXPORT LogSampledState {
+ public:
+  bool ShouldLog(double probability);
+
+ private:
+  std::atomic<uint64_t> suppressed_{0};
+};
+
 }  // namespace log_detail
 
 // Converts std::nullptr_t and null char pointers to the string "null"
@@ -445,6 +668,14 @@ LIBBASE_EXPORT LogSeverity GetMinimumLogSeverity();
 // Set the minimum severity level for logging, returning the old severity.
 LIBBASE_EXPORT LogSeverity SetMinimumLogSeverity(LogSeverity new_severity);
 
+// Set the minimum severity level for messages with the given tag, overriding the
+// global minimum (in either direction) for that tag.  A null tag in ShouldLog()
+// refers to the default tag.
+LIBBASE_EXPORT void SetTagMinimumLogSeverity(const std::string& tag, LogSeverity severity);
+
+// Remove every per-tag minimum severity level, so that all tags use the global minimum again.
+LIBBASE_EXPORT void ClearTagMinimumLogSeverities();
+
 // Return whether or not a log message with the associated tag should be logged.
 LIBBASE_EXPORT bool ShouldLog(LogSeverity severity, const char* tag);
 
@@ -458,6 +689,53 @@ class LIBBASE_EXPORT ScopedLogSeverity {
   LogSeverity old_;
 };
 
+// Attaches a key=value field to every message the current thread logs while it's in scope, for
+// example a request id:
+//
+//     ScopedLogContext context("req", request_id);
+//     LOG(INFO) << "done";  // Written to stderr as "... [req=42] done".
+//
+// StderrLogger, FileLogger, LogdLogger and KernelLogger add the thread's fields (see
+// GetLogContext()) to the header of each line, and AsyncLogger carries them to its writer thread
+// with each message.  LOGB messages don't carry them.
+//
+// A field is rendered once, when it's attached, into a fixed-size thread-local buffer, so logging
+// never allocates for it.  A field that doesn't fit (beyond kMaxFields fields, or kMaxSize bytes
+// in all) is dropped.  ScopedLogContexts must be destroyed in the reverse order of their creation,
+// which scoping guarantees.
+class LIBBASE_EXPORT ScopedLogContext {
+ public:
+  static constexpr size_t kMaxFields = 16;
+  static constexpr size_t kMaxSize = 256;
+
+  ScopedLogContext(std::string_view key, std::string_view value) { Push(key, value); }
+
+  ScopedLogContext(std::string_view key, const char* value)
+      : ScopedLogContext(key, std::string_view(value != nullptr ? value : "(null)")) {}
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+  ScopedLogContext(std::string_view key, T value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    Push(key, std::string_view(buffer, result.ptr - buffer));
+  }
+
+  ~ScopedLogContext();
+
+ private:
+  void Push(std::string_view key, std::string_view value);
+
+  size_t saved_size_;
+  bool pushed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLogContext);
+};
+
+// Returns the fields attached to the current thread's messages as "key=value key=value", or an
+// empty string if there are none.  The result is valid until the thread's fields next change.
+LIBBASE_EXPORT std::string_view GetLogContext();
+
 }  // namespace base
 }  // namespace android
 
@@ -18,59 +18,188 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <charconv>
 #include <limits>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "android-base/parseint.h"
 
 namespace android {
 namespace base {
 
-// Parse floating value in the string 's' and sets 'out' to that value if it exists.
-// Optionally allows the caller to define a 'min' and 'max' beyond which
-// otherwise valid values will be rejected. Returns boolean success.
-template <typename T, T (*strtox)(const char* str, char** endptr)>
-static inline bool ParseFloatingPoint(const char* s, T* out, T min, T max) {
+namespace internal {
+
+// Returns the size of the longest prefix of `s` that could belong to a number strtod() accepts:
+// letters and digits (which covers exponents, hex digits, "inf" and "nan"), '.', signs, and the
+// '(', '_' and ')' of "nan(...)".  Nothing after that prefix can change how it's parsed.
+constexpr size_t FloatingPointPrefixSize(std::string_view s) {
+  size_t i = 0;
+  for (; i < s.size(); ++i) {
+    char ch = s[i];
+    if (!((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') || ch == '.' ||
+          ch == '+' || ch == '-' || ch == '(' || ch == '_' || ch == ')')) {
+      break;
+    }
+  }
+  return i;
+}
+
+// ConvertFloatingPoint for toolchains without a floating point std::from_chars (such as the
+// libc++ that Android ships).  strtod() needs a NUL-terminated copy, which only has to cover the
+// number itself, not any text after it, so it usually fits on the stack.
+template <typename T>
+ParseError StrtodFloatingPoint(std::string_view s, bool hex, T* value, size_t* end) {
+  s = s.substr(0, FloatingPointPrefixSize(s));
+  size_t prefix_size = hex ? 2 : 0;
+  char buffer[64];
+  std::string heap_buffer;
+  const char* begin = buffer;
+  if (prefix_size + s.size() < sizeof(buffer)) {
+    memcpy(buffer, "0x", prefix_size);
+    memcpy(buffer + prefix_size, s.data(), s.size());
+    buffer[prefix_size + s.size()] = '\0';
+  } else {
+    heap_buffer.assign(hex ? "0x" : "");
+    heap_buffer.append(s);
+    begin = heap_buffer.c_str();
+  }
+  char* ptr;
+  int saved_errno = errno;
   errno = 0;
-  char* end;
-  T result = strtox(s, &end);
-  if (errno != 0 || s == end || *end != '\0') {
-    return false;
+  if constexpr (std::is_same<T, float>::value) {
+    *value = strtof(begin, &ptr);
+  } else if constexpr (std::is_same<T, double>::value) {
+    *value = strtod(begin, &ptr);
+  } else {
+    *value = strtold(begin, &ptr);
+  }
+  // As with std::from_chars, only a result that's lost entirely is out of range, not a denormal.
+  bool out_of_range = errno == ERANGE && (*value == 0 || *value > std::numeric_limits<T>::max() ||
+                                          *value < std::numeric_limits<T>::lowest());
+  errno = saved_errno;
+  size_t consumed = ptr - begin;
+  if (consumed == 0 || (hex && consumed <= 2)) {
+    *end = 0;
+    return ParseError::kInvalid;
   }
-  if (result < min || max < result) {
-    return false;
+  *end = consumed - prefix_size;
+  return out_of_range ? ParseError::kOutOfRange : ParseError::kOk;
+}
+
+// Converts the unsigned floating point number at the start of `s`, as strtod() would, setting
+// *end to the index just past it.  `hex` numbers have had their "0x" removed.
+template <typename T>
+ParseError ConvertFloatingPoint(std::string_view s, bool hex, T* value, size_t* end) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), *value,
+                                   hex ? std::chars_format::hex : std::chars_format::general);
+  *end = ptr - s.data();
+  if (ec == std::errc::invalid_argument) return ParseError::kInvalid;
+  if (ec == std::errc::result_out_of_range) return ParseError::kOutOfRange;
+  return ParseError::kOk;
+#else
+  return StrtodFloatingPoint(s, hex, value, end);
+#endif
+}
+
+// The first stage of parsing a floating point number, as ScanSigned is for integers.
+template <typename T>
+ParseError ScanFloatingPoint(std::string_view s, T* value, size_t* start, size_t* end) {
+  size_t i = 0;
+  while (i < s.size() && IsParseSpace(s[i])) ++i;
+  *start = i;
+  bool negative = false;
+  if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+    negative = s[i] == '-';
+    ++i;
   }
-  if (out != nullptr) {
-    *out = result;
+  // std::from_chars takes neither a leading '+' nor the "0x" of a hexadecimal number, both of
+  // which strtod() has always accepted.
+  bool hex = i + 1 < s.size() && s[i] == '0' && (s[i + 1] == 'x' || s[i + 1] == 'X');
+  size_t digits = hex ? i + 2 : i;
+  *end = digits;
+  // Nor would strtod() take "0xinf" or a second sign, both of which std::from_chars would.
+  if (digits == s.size() || s[digits] == '+' || s[digits] == '-' || IsParseSpace(s[digits]) ||
+      (hex && s[digits] != '.' && HexDigitValue(s[digits]) >= 16)) {
+    return ParseError::kInvalid;
   }
-  return true;
+  size_t size;
+  ParseError error = ConvertFloatingPoint(s.substr(digits), hex, value, &size);
+  if (error != ParseError::kOk) return error;
+  *end = digits + size;
+  if (negative) *value = -*value;
+  return ParseError::kOk;
+}
+
+}  // namespace internal
+
+// Parses the floating point number in 's', which needn't be NUL-terminated, as ParseDouble or
+// ParseFloat would for T, and reports where it went wrong if it did.  See parseint.h for the
+// integer equivalent.
+template <typename T>
+std::enable_if_t<std::is_floating_point<T>::value, ParseResult<T>> ParseNumber(
+    std::string_view s, T min = std::numeric_limits<T>::lowest(),
+    T max = std::numeric_limits<T>::max()) {
+  T value;
+  size_t start, end;
+  ParseError error = internal::ScanFloatingPoint(s, &value, &start, &end);
+  if (error != ParseError::kOk) {
+    return internal::ParseFailure<T>(error, internal::ScanErrorPosition(error, start, end));
+  }
+  if (end != s.size()) return internal::ParseFailure<T>(ParseError::kInvalid, end);
+  return internal::CheckRange(value, min, max, start, s.size());
 }
 
 // Parse double value in the string 's' and sets 'out' to that value if it exists.
 // Optionally allows the caller to define a 'min' and 'max' beyond which
 // otherwise valid values will be rejected. Returns boolean success.
+static inline bool ParseDouble(std::string_view s, double* out,
+                               double min = std::numeric_limits<double>::lowest(),
+                               double max = std::numeric_limits<double>::max()) {
+  ParseResult<double> result = ParseNumber<double>(s, min, max);
+  if (result.ok() && out != nullptr) {
+    *out = result.value;
+  }
+  errno = internal::ParseErrorToErrno(result.error);
+  return result.ok();
+}
 static inline bool ParseDouble(const char* s, double* out,
                                double min = std::numeric_limits<double>::lowest(),
                                double max = std::numeric_limits<double>::max()) {
-  return ParseFloatingPoint<double, strtod>(s, out, min, max);
+  return ParseDouble(std::string_view(s), out, min, max);
 }
 static inline bool ParseDouble(const std::string& s, double* out,
                                double min = std::numeric_limits<double>::lowest(),
                                double max = std::numeric_limits<double>::max()) {
-  return ParseFloatingPoint<double, strtod>(s.c_str(), out, min, max);
+  return ParseDouble(std::string_view(s), out, min, max);
 }
 
 // Parse float value in the string 's' and sets 'out' to that value if it exists.
 // Optionally allows the caller to define a 'min' and 'max' beyond which
 // otherwise valid values will be rejected. Returns boolean success.
+static inline bool ParseFloat(std::string_view s, float* out,
+                              float min = std::numeric_limits<float>::lowest(),
+                              float max = std::numeric_limits<float>::max()) {
+  ParseResult<float> result = ParseNumber<float>(s, min, max);
+  if (result.ok() && out != nullptr) {
+    *out = result.value;
+  }
+  errno = internal::ParseErrorToErrno(result.error);
+  return result.ok();
+}
 static inline bool ParseFloat(const char* s, float* out,
                               float min = std::numeric_limits<float>::lowest(),
                               float max = std::numeric_limits<float>::max()) {
-  return ParseFloatingPoint<float, strtof>(s, out, min, max);
+  return ParseFloat(std::string_view(s), out, min, max);
 }
 static inline bool ParseFloat(const std::string& s, float* out,
                               float min = std::numeric_limits<float>::lowest(),
                               float max = std::numeric_limits<float>::max()) {
-  return ParseFloatingPoint<float, strtof>(s.c_str(), out, min, max);
+  return ParseFloat(std::string_view(s), out, min, max);
 }
 
 }  // namespace base
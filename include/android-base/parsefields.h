@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// Parsing records of delimited fields.
+//
+
+// ParseFields parses the leading fields of a line such as those in /proc/<pid>/stat or
+// /proc/meminfo straight into variables, in one pass over the line and without copying:
+//
+//   long long total_kb;
+//   if (!ParseFields(line, " ", nullptr, &total_kb)) ...  // "MemTotal:    3809036 kB"
+//
+// Fields are split as Tokenize splits them, so runs of delimiters count as one, and each field
+// is parsed as ParseInt, ParseUint, ParseDouble or ParseFloat would parse it on its own.
+
+#include <stddef.h>
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "android-base/parsedouble.h"
+#include "android-base/parseint.h"
+#include "android-base/strings.h"
+
+namespace android {
+namespace base {
+
+namespace internal {
+
+// Walks a line field by field for ParseFields.
+class FieldParser {
+ public:
+  FieldParser(std::string_view line, std::string_view delimiters)
+      : line_(line), delimiters_(delimiters) {
+    // A number is scanned straight out of the line, and must then be followed by a delimiter,
+    // which only works if no delimiter could be part of a number.  Otherwise each field is found
+    // first, and the number parsed from that.
+    for (char ch : delimiters) {
+      if ((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') ||
+          std::string_view("+-._()").find(ch) != std::string_view::npos) {
+        numeric_delimiters_ = true;
+      }
+    }
+  }
+
+  // Skips a field, without looking at it.
+  bool Next(std::nullptr_t) {
+    if (!Start()) return false;
+    pos_ = FieldEnd();
+    return true;
+  }
+
+  // Parses the next field into *out, or just checks it if `out` is null.
+  template <typename T>
+  bool Next(T* out) {
+    if (!Start()) return false;
+    if constexpr (std::is_same<T, std::string_view>::value ||
+                  std::is_same<T, std::string>::value) {
+      size_t end = FieldEnd();
+      if (out != nullptr) *out = T(line_.substr(pos_, end - pos_));
+      pos_ = end;
+      return true;
+    } else {
+      static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                    "ParseFields can only parse numbers and strings");
+      std::string_view rest = line_.substr(pos_);
+      // A field that starts with whitespace that isn't a delimiter would have it skipped by the
+      // scan, which mustn't run on into the next field.
+      if (numeric_delimiters_ || IsParseSpace(rest[0])) rest = rest.substr(0, FieldEnd() - pos_);
+
+      // Integers are scanned as the widest type of their signedness, as ParseInt does.
+      using Wide = std::conditional_t<
+          std::is_floating_point<T>::value, T,
+          std::conditional_t<std::is_signed<T>::value, long long, unsigned long long>>;
+      Wide value;
+      size_t start, end;
+      ParseError error;
+      if constexpr (std::is_floating_point<T>::value) {
+        error = ScanFloatingPoint(rest, &value, &start, &end);
+      } else if constexpr (std::is_signed<T>::value) {
+        error = ScanSigned(rest, &value, &start, &end);
+      } else {
+        error = ScanUnsigned(rest, &value, &start, &end);
+      }
+      if (error != ParseError::kOk) {
+        return Fail(error, pos_ + ScanErrorPosition(error, start, end));
+      }
+      // The number must be the whole of its field, as it would be if the field had been parsed
+      // on its own, before it's checked against T's range.
+      if (pos_ + end != line_.size() && !delimiters_.Contains(line_[pos_ + end])) {
+        return Fail(ParseError::kInvalid, pos_ + end);
+      }
+      ParseResult<T> result = CheckRange(value, std::numeric_limits<T>::lowest(),
+                                         std::numeric_limits<T>::max(), start, end);
+      if (!result.ok()) return Fail(result.error, pos_ + start);
+      if (out != nullptr) *out = result.value;
+      pos_ += end;
+      return true;
+    }
+  }
+
+  ParseResult<size_t> Result() const {
+    if (error_ != ParseError::kOk) return ParseFailure<size_t>(error_, pos_);
+    return {pos_, ParseError::kOk, line_.size()};
+  }
+
+ private:
+  // Moves to the start of the next field.
+  bool Start() {
+    if (pos_ < line_.size() && delimiters_.Contains(line_[pos_])) {
+      ++pos_;
+      // Runs of more than one delimiter, as in /proc/meminfo, are left to the vectorized scan.
+      if (pos_ < line_.size() && delimiters_.Contains(line_[pos_])) {
+        pos_ = delimiters_.FindNot(line_, pos_);
+        if (pos_ == std::string_view::npos) pos_ = line_.size();
+      }
+    }
+    if (pos_ == line_.size()) return Fail(ParseError::kInvalid, pos_);
+    return true;
+  }
+
+  // Returns the end of the field that starts at pos_.
+  size_t FieldEnd() const {
+    size_t end = delimiters_.Find(line_, pos_);
+    return end == std::string_view::npos ? line_.size() : end;
+  }
+
+  bool Fail(ParseError error, size_t position) {
+    error_ = error;
+    pos_ = position;
+    return false;
+  }
+
+  std::string_view line_;
+  DelimiterSet delimiters_;
+  bool numeric_delimiters_ = false;
+  // The end of the last field parsed, or where parsing failed.
+  size_t pos_ = 0;
+  ParseError error_ = ParseError::kOk;
+};
+
+}  // namespace internal
+
+// Parses the first sizeof...(outs) fields of `line`, separated by runs of any of the bytes in
+// `delimiters`, into `outs`, and ignores any fields after them.  Each of `outs` may point to an
+// integer or floating point type, to have its field parsed as ParseInt, ParseUint or ParseDouble
+// would; to a std::string_view or std::string, to have its field stored as is; or may be nullptr,
+// to have its field skipped.  A null pointer to a number has its field checked but not stored.
+//
+// On success, the result's value is the index just past the last field parsed, where any further
+// fields begin.  On failure, its error and position are those parsing the field on its own would
+// have reported, but as indexes into `line`, or kInvalid at the end of `line` if there are too
+// few fields.  The fields before the one that failed will have been stored.
+template <typename... Outs>
+ParseResult<size_t> ParseFields(std::string_view line, std::string_view delimiters,
+                                Outs... outs) {
+  static_assert(((std::is_pointer<Outs>::value || std::is_null_pointer<Outs>::value) && ...),
+                "ParseFields takes pointers to where to put each field");
+  internal::FieldParser parser(line, delimiters);
+  (parser.Next(outs) && ...);
+  return parser.Result();
+}
+
+}  // namespace base
+}  // namespace android
@@ -19,11 +19,13 @@
 #define NOMINMAX
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <limits>
 #include <string>
+#include <string_view>
 #include <type_traits>
 
 #ifdef max
@@ -37,70 +39,324 @@
 namespace android {
 namespace base {
 
-// Parses the unsigned decimal or hexadecimal integer in the string 's' and sets
-// 'out' to that value if it is specified. Optionally allows the caller to define
-// a 'max' beyond which otherwise valid values will be rejected. Returns boolean
-// success; 'out' is untouched if parsing fails.
-template <typename T>
-bool ParseUint(const char* s, T* out, T max = std::numeric_limits<T>::max(),
-               bool allow_suffixes = false) {
-  static_assert(std::is_unsigned<T>::value, "ParseUint can only be used with unsigned types");
-  while (isspace(*s)) {
-    s++;
-  }
+// Why a parse failed.
+enum class ParseError {
+  kOk = 0,
+  // Not a number, or a number followed by something other than an allowed suffix.
+  kInvalid,
+  // A number, but outside the range of the type or of the caller's bounds.
+  kOutOfRange,
+};
+
+namespace internal {
+
+// ASCII whitespace, as isspace() has it in the "C" locale.
+constexpr bool IsParseSpace(char ch) {
+  return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+// Returns the value of the hexadecimal digit `ch`, or 16 if it isn't one.
+constexpr unsigned HexDigitValue(char ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  char lower = static_cast<char>(ch | 0x20);
+  return (lower >= 'a' && lower <= 'f') ? lower - 'a' + 10 : 16;
+}
+
+#if defined(__BYTE_ORDER__)
+constexpr bool kLittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+constexpr bool kLittleEndian = true;  // MSVC only targets little-endian machines.
+#endif
 
-  if (s[0] == '-') {
-    errno = EINVAL;
+// If the eight bytes at `p` are all decimal digits, sets *value to the number they spell and
+// returns true.  All eight are checked and decoded at once, in a 64-bit word.
+inline bool ParseEightDigits(const char* p, uint64_t* value) {
+  if (!kLittleEndian) return false;
+  uint64_t chunk;
+  memcpy(&chunk, p, sizeof(chunk));
+  // A byte is a digit if its high nibble is 3 and adding 6 doesn't carry out of its low nibble.
+  if (((chunk & 0xf0f0f0f0f0f0f0f0) |
+       (((chunk + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) != 0x3333333333333333) {
     return false;
   }
+  chunk -= 0x3030303030303030;
+  // Combine neighbouring digits into two-digit numbers, then four-digit, then eight.
+  chunk = chunk * 10 + (chunk >> 8);
+  chunk = ((chunk & 0x000000ff000000ff) * (100 + (1000000ULL << 32)) +
+           ((chunk >> 16) & 0x000000ff000000ff) * (1 + (10000ULL << 32))) >>
+          32;
+  *value = chunk;
+  return true;
+}
 
-  int base = (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) ? 16 : 10;
-  errno = 0;
-  char* end;
-  unsigned long long int result = strtoull(s, &end, base);
-  if (errno != 0) return false;
-  if (end == s) {
-    errno = EINVAL;
-    return false;
+// Parses the run of decimal digits at s[*pos] into *value, and advances *pos past them.  Returns
+// false if the value doesn't fit in 64 bits (having still consumed every digit).
+inline bool ParseDecimalDigits(std::string_view s, size_t* pos, unsigned long long* value) {
+  size_t i = *pos;
+  // Leading zeros can't overflow, however many there are.
+  while (i < s.size() && s[i] == '0') ++i;
+  size_t start = i;
+  unsigned long long result = 0;
+  // Any 19 digits fit in 64 bits, so the first 16 need no overflow checks.
+  uint64_t eight;
+  while (i - start <= 8 && i + 8 <= s.size() && ParseEightDigits(s.data() + i, &eight)) {
+    result = result * 100000000 + eight;
+    i += 8;
   }
-  if (*end != '\0') {
-    const char* suffixes = "bkmgtpe";
-    const char* suffix = strchr( suffixes, tolower( *end ) );
-    bool __did = 1ULL << ( 10 * ( suffix - suffixes ) ) && ( ( std::numeric_limits<unsigned long long int>::max )( ) / 1ULL << ( 10 * ( suffix - suffixes ) ) ) < result;
-    result = result * 1ULL << ( 10 * ( suffix - suffixes ) );
-
-    if ((!allow_suffixes || (suffix ) == nullptr) ||
-        __did ) {
-      errno = EINVAL;
-      return false;
+  bool fits = true;
+  for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+    unsigned digit = s[i] - '0';
+    if (result > (std::numeric_limits<unsigned long long>::max() - digit) / 10) {
+      fits = false;
+    } else {
+      result = result * 10 + digit;
     }
   }
-  if (max < result) {
-    errno = ERANGE;
-    return false;
+  *pos = i;
+  *value = result;
+  return fits;
+}
+
+// Parses the integer at the start of `s` as strtoull() would in the base ParseInt and ParseUint
+// have always chosen: after any whitespace, a hexadecimal number if it starts with "0x", and
+// otherwise a decimal number with an optional sign.  Sets *magnitude and *negative, *start to
+// the index of the number (its sign, if any), and *end to the index just past the last digit, or
+// where the first digit should have been.  Returns kInvalid if there are no digits, and
+// kOutOfRange if the magnitude doesn't fit in 64 bits.
+inline ParseError ParseMagnitude(std::string_view s, unsigned long long* magnitude,
+                                 bool* negative, size_t* start, size_t* end) {
+  size_t i = 0;
+  while (i < s.size() && IsParseSpace(s[i])) ++i;
+  *start = i;
+  *negative = false;
+  bool fits;
+  size_t digits;
+  if (i + 1 < s.size() && s[i] == '0' && (s[i + 1] == 'x' || s[i + 1] == 'X')) {
+    i += 2;
+    digits = i;
+    unsigned long long result = 0;
+    fits = true;
+    for (unsigned digit; i < s.size() && (digit = HexDigitValue(s[i])) < 16; ++i) {
+      if (result >> 60 != 0) fits = false;
+      result = result << 4 | digit;
+    }
+    *magnitude = result;
+  } else {
+    if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+      *negative = s[i] == '-';
+      ++i;
+    }
+    digits = i;
+    fits = ParseDecimalDigits(s, &i, magnitude);
+  }
+  *end = i;
+  if (i == digits) return ParseError::kInvalid;
+  if (!fits) return ParseError::kOutOfRange;
+  return ParseError::kOk;
+}
+
+// The errno value that the bool-returning functions have always reported for `error`.
+inline int ParseErrorToErrno(ParseError error) {
+  switch (error) {
+    case ParseError::kOk:
+      return 0;
+    case ParseError::kInvalid:
+      return EINVAL;
+    case ParseError::kOutOfRange:
+      return ERANGE;
   }
-  if (out != nullptr) {
-    *out = static_cast<T>(result);
+  return EINVAL;
+}
+
+}  // namespace internal
+
+// The outcome of parsing a number, for callers that want to say what was wrong with their input.
+// On success, 'value' is the number and 'position' is the size of the input.  On failure, 'value'
+// is zero and 'position' is the index of the first byte that couldn't be parsed, or for
+// kOutOfRange the index at which the offending number starts.
+template <typename T>
+struct ParseResult {
+  T value{};
+  ParseError error = ParseError::kOk;
+  size_t position = 0;
+
+  bool ok() const { return error == ParseError::kOk; }
+  explicit operator bool() const { return ok(); }
+};
+
+namespace internal {
+
+template <typename T>
+ParseResult<T> ParseFailure(ParseError error, size_t position) {
+  ParseResult<T> result;
+  result.error = error;
+  result.position = position;
+  return result;
+}
+
+// Parsing is done in two stages, so that parsefields.h can check what follows a number between
+// them.  The first scans the number at the start of `s`, which may be followed by anything, and
+// sets *start and *end as ParseMagnitude does.  The position of a failure is then
+// ScanErrorPosition().  The second checks the number against the caller's bounds.
+
+inline ParseError ScanUnsigned(std::string_view s, unsigned long long* value, size_t* start,
+                               size_t* end) {
+  bool negative;
+  ParseError error = ParseMagnitude(s, value, &negative, start, end);
+  // A minus sign is rejected whatever follows it, as ParseUint always has.
+  if (negative) {
+    *end = *start;
+    return ParseError::kInvalid;
   }
-  return true;
+  return error;
+}
+
+inline ParseError ScanSigned(std::string_view s, long long* value, size_t* start, size_t* end) {
+  unsigned long long magnitude;
+  bool negative;
+  ParseError error = ParseMagnitude(s, &magnitude, &negative, start, end);
+  if (error != ParseError::kOk) return error;
+  // As with strtoll(), overflowing a long long takes precedence over trailing junk.
+  constexpr unsigned long long kMax = std::numeric_limits<long long>::max();
+  if (magnitude > (negative ? kMax + 1 : kMax)) return ParseError::kOutOfRange;
+  *value = negative ? static_cast<long long>(0 - magnitude) : static_cast<long long>(magnitude);
+  return ParseError::kOk;
+}
+
+inline size_t ScanErrorPosition(ParseError error, size_t start, size_t end) {
+  return error == ParseError::kInvalid ? end : start;
+}
+
+template <typename T, typename V>
+ParseResult<T> CheckRange(V value, T min, T max, size_t start, size_t size) {
+  if (value < min || max < value) return ParseFailure<T>(ParseError::kOutOfRange, start);
+  return {static_cast<T>(value), ParseError::kOk, size};
+}
+
+template <typename T>
+ParseResult<T> ParseUnsigned(std::string_view s, T min, T max, bool allow_suffixes) {
+  unsigned long long result;
+  size_t start, end;
+  ParseError error = ScanUnsigned(s, &result, &start, &end);
+  if (error != ParseError::kOk) return ParseFailure<T>(error, ScanErrorPosition(error, start, end));
+  if (end != s.size()) {
+    // A size suffix multiplies by a power of 1024.  Whatever follows it is ignored, as it always
+    // has been, so that "16kB" and "4KB" are 16KiB and 4KiB.
+    constexpr std::string_view kSuffixes = "bkmgtpe";
+    size_t suffix = kSuffixes.find(static_cast<char>(s[end] | 0x20));
+    if (!allow_suffixes || suffix == kSuffixes.npos) {
+      return ParseFailure<T>(ParseError::kInvalid, end);
+    }
+    size_t shift = 10 * suffix;
+    if (result > std::numeric_limits<unsigned long long>::max() >> shift) {
+      return ParseFailure<T>(ParseError::kOutOfRange, start);
+    }
+    result <<= shift;
+  }
+  return CheckRange(result, min, max, start, s.size());
+}
+
+template <typename T>
+ParseResult<T> ParseSigned(std::string_view s, T min, T max) {
+  long long result;
+  size_t start, end;
+  ParseError error = ScanSigned(s, &result, &start, &end);
+  if (error != ParseError::kOk) return ParseFailure<T>(error, ScanErrorPosition(error, start, end));
+  if (end != s.size()) return ParseFailure<T>(ParseError::kInvalid, end);
+  return CheckRange(result, min, max, start, s.size());
+}
+
+}  // namespace internal
+
+// Parses the integer in 's', which needn't be NUL-terminated, as ParseInt or ParseUint would
+// for T, and reports where it went wrong if it did:
+//
+//   auto result = ParseNumber<uint16_t>(field);
+//   if (!result) LOG(ERROR) << "bad port at column " << result.position << ": " << field;
+//
+// parsedouble.h has the floating point equivalent.
+template <typename T>
+std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value, ParseResult<T>>
+ParseNumber(std::string_view s, T min = std::numeric_limits<T>::min(),
+            T max = std::numeric_limits<T>::max()) {
+  if constexpr (std::is_signed<T>::value) {
+    return internal::ParseSigned<T>(s, min, max);
+  } else {
+    return internal::ParseUnsigned<T>(s, min, max, false);
+  }
+}
+
+// Parses the unsigned decimal or hexadecimal integer in 's' and sets 'out' to that value if it
+// is specified, as ParseUint does, but reports failure with a ParseError rather than errno
+// (which is left alone).
+template <typename T>
+ParseError TryParseUint(std::string_view s, T* out, T max = std::numeric_limits<T>::max(),
+                        bool allow_suffixes = false) {
+  static_assert(std::is_unsigned<T>::value, "TryParseUint can only be used with unsigned types");
+  ParseResult<T> result = internal::ParseUnsigned<T>(s, 0, max, allow_suffixes);
+  if (result.ok() && out != nullptr) {
+    *out = result.value;
+  }
+  return result.error;
+}
+
+template <typename T>
+ParseError TryParseByteCount(std::string_view s, T* out, T max = std::numeric_limits<T>::max()) {
+  return TryParseUint(s, out, max, true);
+}
+
+// Parses the signed decimal or hexadecimal integer in 's' and sets 'out' to that value if it is
+// specified, as ParseInt does, but reports failure with a ParseError rather than errno (which is
+// left alone).
+template <typename T>
+ParseError TryParseInt(std::string_view s, T* out, T min = std::numeric_limits<T>::min(),
+                       T max = std::numeric_limits<T>::max()) {
+  static_assert(std::is_signed<T>::value, "TryParseInt can only be used with signed types");
+  ParseResult<T> result = internal::ParseSigned<T>(s, min, max);
+  if (result.ok() && out != nullptr) {
+    *out = result.value;
+  }
+  return result.error;
+}
+
+// Parses the unsigned decimal or hexadecimal integer in the string 's' and sets
+// 'out' to that value if it is specified. Optionally allows the caller to define
+// a 'max' beyond which otherwise valid values will be rejected. Returns boolean
+// success; 'out' is untouched if parsing fails.
+template <typename T>
+bool ParseUint(std::string_view s, T* out, T max = std::numeric_limits<T>::max(),
+               bool allow_suffixes = false) {
+  static_assert(std::is_unsigned<T>::value, "ParseUint can only be used with unsigned types");
+  ParseError error = TryParseUint(s, out, max, allow_suffixes);
+  errno = internal::ParseErrorToErrno(error);
+  return error == ParseError::kOk;
+}
+
+template <typename T>
+bool ParseUint(const char* s, T* out, T max = std::numeric_limits<T>::max(),
+               bool allow_suffixes = false) {
+  return ParseUint(std::string_view(s), out, max, allow_suffixes);
 }
 
-// TODO: string_view
 template <typename T>
 bool ParseUint(const std::string& s, T* out, T max = std::numeric_limits<T>::max(),
                bool allow_suffixes = false) {
-  return ParseUint(s.c_str(), out, max, allow_suffixes);
+  return ParseUint(std::string_view(s), out, max, allow_suffixes);
 }
 
 template <typename T>
-bool ParseByteCount(const char* s, T* out, T max = std::numeric_limits<T>::max()) {
+bool ParseByteCount(std::string_view s, T* out, T max = std::numeric_limits<T>::max()) {
   return ParseUint(s, out, max, true);
 }
 
-// TODO: string_view
+template <typename T>
+bool ParseByteCount(const char* s, T* out, T max = std::numeric_limits<T>::max()) {
+  return ParseByteCount(std::string_view(s), out, max);
+}
+
 template <typename T>
 bool ParseByteCount(const std::string& s, T* out, T max = std::numeric_limits<T>::max()) {
-  return ParseByteCount(s.c_str(), out, max);
+  return ParseByteCount(std::string_view(s), out, max);
 }
 
 // Parses the signed decimal or hexadecimal integer in the string 's' and sets
@@ -108,41 +364,27 @@ bool ParseByteCount(const std::string& s, T* out, T max = std::numeric_limits<T>
 // a 'min' and 'max' beyond which otherwise valid values will be rejected. Returns
 // boolean success; 'out' is untouched if parsing fails.
 template <typename T>
-bool ParseInt(const char* s, T* out,
+bool ParseInt(std::string_view s, T* out,
               T min = std::numeric_limits<T>::min(),
               T max = std::numeric_limits<T>::max()) {
   static_assert(std::is_signed<T>::value, "ParseInt can only be used with signed types");
-  while (isspace(*s)) {
-    s++;
-  }
+  ParseError error = TryParseInt(s, out, min, max);
+  errno = internal::ParseErrorToErrno(error);
+  return error == ParseError::kOk;
+}
 
-  int base = (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) ? 16 : 10;
-  errno = 0;
-  char* end;
-  long long int result = strtoll(s, &end, base);
-  if (errno != 0) {
-    return false;
-  }
-  if (s == end || *end != '\0') {
-    errno = EINVAL;
-    return false;
-  }
-  if (result < min || max < result) {
-    errno = ERANGE;
-    return false;
-  }
-  if (out != nullptr) {
-    *out = static_cast<T>(result);
-  }
-  return true;
+template <typename T>
+bool ParseInt(const char* s, T* out,
+              T min = std::numeric_limits<T>::min(),
+              T max = std::numeric_limits<T>::max()) {
+  return ParseInt(std::string_view(s), out, min, max);
 }
 
-// TODO: string_view
 template <typename T>
 bool ParseInt(const std::string& s, T* out,
               T min = std::numeric_limits<T>::min(),
               T max = std::numeric_limits<T>::max()) {
-  return ParseInt(s.c_str(), out, min, max);
+  return ParseInt(std::string_view(s), out, min, max);
 }
 
 }  // namespace base
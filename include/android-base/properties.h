@@ -22,6 +22,7 @@
 #include <string>
 
 #include <android-base\parseint.h>
+#include <android-base\string_pool.h>
 
 #include <android-base\libbase_export.h>
 
@@ -100,7 +101,8 @@ class CachedProperty {
   const char* Get(bool* changed = nullptr);
 
  private:
-  std::string property_name_;
+  // Interned, since the same few properties tend to be cached all over a process.
+  InternedString property_name_;
   const prop_info* prop_info_;
   std::optional<uint32_t> cached_area_serial_;
   std::optional<uint32_t> cached_property_serial_;
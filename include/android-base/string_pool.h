@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+//
+// Interned strings.
+//
+
+// A StringPool stores each distinct string once, and hands out InternedStrings that refer to it:
+//
+//   InternedString tag = StringPool::Global().Intern("ActivityManager");
+//   tag == StringPool::Global().Intern(other_tag)  // A pointer comparison.
+//
+// Strings that are stored and compared many times over (log tags, property names, keys read from
+// config files) then cost one copy between them, and comparing or hashing one is O(1) whatever its
+// length.  Interned strings live as long as their pool; the Global() pool is never destroyed, so
+// its strings can be kept anywhere, including in other global state.
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <android-base\libbase_export.h>
+
+namespace android {
+namespace base {
+
+namespace internal {
+// The header of a string in a StringPool's arena.  The string itself, NUL-terminated, follows it.
+struct InternedEntry {
+  size_t size;
+  // std::hash<std::string_view> of the string.
+  size_t hash;
+};
+}  // namespace internal
+
+// A string in a StringPool.  Cheap to copy (it's a pointer) and immutable.  Two InternedStrings
+// from the same pool are equal if and only if their strings are, so they compare by pointer.
+// InternedStrings from different pools never compare equal unless both are empty.
+class InternedString {
+ public:
+  // The empty string, which is the same in every pool.
+  constexpr InternedString() = default;
+
+  const char* c_str() const { return data(); }
+  const char* data() const {
+    return entry_ != nullptr ? reinterpret_cast<const char*>(entry_ + 1) : "";
+  }
+  size_t size() const { return entry_ != nullptr ? entry_->size : 0; }
+  bool empty() const { return entry_ == nullptr; }
+
+  std::string_view view() const { return std::string_view(data(), size()); }
+  operator std::string_view() const { return view(); }
+
+  bool operator==(InternedString other) const { return entry_ == other.entry_; }
+  bool operator!=(InternedString other) const { return entry_ != other.entry_; }
+
+  // A hash of the string's identity, for std::hash.
+  size_t hash() const { return std::hash<const void*>()(entry_); }
+
+  // std::hash<std::string_view>()(view()), without rehashing the string.
+  size_t content_hash() const {
+    return entry_ != nullptr ? entry_->hash : std::hash<std::string_view>()({});
+  }
+
+ private:
+  friend class StringPool;
+
+  explicit InternedString(const internal::InternedEntry* entry) : entry_(entry) {}
+
+  const internal::InternedEntry* entry_ = nullptr;
+};
+
+// A set of interned strings.  Interning is thread-safe: the pool is split into shards by hash,
+// each with its own lock, so concurrent callers rarely wait for one another.  The strings
+// themselves are bump-allocated from per-shard arenas, and are freed only with the pool.
+class LIBBASE_EXPORT StringPool {
+ public:
+  StringPool();
+  ~StringPool();
+
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // Returns the InternedString for `s`, adding it to the pool if necessary.
+  InternedString Intern(std::string_view s);
+
+  // Returns the InternedString for `s` if it's in the pool, without adding it.
+  std::optional<InternedString> Find(std::string_view s) const;
+
+  // Returns the number of distinct non-empty strings in the pool.
+  size_t size() const;
+
+  // Returns the number of bytes the pool has allocated for its strings and their index.
+  size_t memory_usage() const;
+
+  // A process-wide pool, for strings shared between libraries and threads.
+  static StringPool& Global();
+
+ private:
+  struct Shard;
+  // Strings are sharded by the top kShardBits bits of their hash.
+  static constexpr size_t kShardBits = 4;
+  static constexpr size_t kShardCount = 1 << kShardBits;
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace base
+}  // namespace android
+
+namespace std {
+template <>
+struct hash<android::base::InternedString> {
+  size_t operator()(android::base::InternedString s) const { return s.hash(); }
+};
+}  // namespace std
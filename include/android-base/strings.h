@@ -17,7 +17,14 @@
 #pragma once
 
 #include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -25,6 +32,8 @@
 #include <utility>
 #include <vector>
 
+#include "android-base/function_ref.h"
+
 #include <android-base\libbase_export.h>
 
 namespace android {
@@ -52,11 +61,215 @@ LIBBASE_EXPORT std::vector<std::string> Split(const std::string& s,
 // The empty string is not a valid delimiter list.
 LIBBASE_EXPORT std::vector<std::string> Tokenize(const std::string& s, const std::string& delimiters);
 
+// Like Split, but returns views of `s` rather than copies, so that splitting a large string
+// doesn't allocate a string per piece.  The views are only valid for as long as `s` is.
+LIBBASE_EXPORT std::vector<std::string_view> SplitToViews(std::string_view s,
+                                                          std::string_view delimiters);
+
+// Like Tokenize, but returns views of `s` rather than copies.  The views are only valid for as
+// long as `s` is.
+LIBBASE_EXPORT std::vector<std::string_view> TokenizeToViews(std::string_view s,
+                                                             std::string_view delimiters);
+
+namespace internal {
+
+// A set of delimiter bytes, and a fast scan for the next one, shared by Split, Tokenize and
+// their variants.  Membership is a 256-bit bitmap; a set of up to kMaxVectorDelimiters bytes is
+// also scanned 16 or 32 bytes at a time with SSE2, AVX2 or (on 64-bit ARM) NEON where available.
+class LIBBASE_EXPORT DelimiterSet {
+ public:
+  static constexpr size_t kMaxVectorDelimiters = 16;
+
+  explicit DelimiterSet(std::string_view delimiters);
+
+  bool Contains(char ch) const {
+    unsigned char byte = static_cast<unsigned char>(ch);
+    return (bits_[byte / 64] >> (byte % 64)) & 1;
+  }
+
+  // Returns the index of the first byte of `s` at or after `pos` that is in the set, or
+  // std::string_view::npos if there is none.
+  size_t Find(std::string_view s, size_t pos = 0) const;
+
+  // Returns the index of the first byte of `s` at or after `pos` that isn't in the set, or
+  // std::string_view::npos if there is none.
+  size_t FindNot(std::string_view s, size_t pos = 0) const;
+
+  // Calls on_match(i) with the index of each byte of `s` at or after `pos` that is in the set, in
+  // order.  on_match returns the index to carry on from, which must be greater than i, or
+  // std::string_view::npos to stop.  Cheaper than repeated calls to Find when matches are
+  // frequent.
+  void FindEach(std::string_view s, size_t pos, function_ref<size_t(size_t)> on_match) const;
+
+ private:
+  template <bool kMatch, typename F>
+  void Scan(std::string_view s, size_t pos, const F& on_match) const;
+
+  uint64_t bits_[4] = {};
+  // The distinct delimiters, if there are no more than kMaxVectorDelimiters of them.
+  char delimiters_[kMaxVectorDelimiters];
+  size_t count_ = 0;
+};
+
+}  // namespace internal
+
+// A lazy range over the pieces of `s` between delimiters, for when the pieces needn't all be
+// kept: the string is only scanned as far as the iteration goes, and nothing is allocated.
+// The pieces are views of `s`, so are only valid for as long as it is.  By default the pieces
+// are those Split would return; SkipEmpty() gives those Tokenize would, and MaxSplits(n) stops
+// splitting after `n` delimiters and returns the rest of the string as the last piece.
+//
+// Example:
+//   for (std::string_view field : SplitView(line, " ").SkipEmpty().MaxSplits(1)) { ... }
+//   SplitView("a:b:c", ":").MaxSplits(1) => {"a", "b:c"}
+//   SplitView("  a  b  c  ", " ").SkipEmpty().MaxSplits(1) => {"a", "b  c  "}
+//
+// Iterators are only valid for as long as the SplitView they came from.  The empty string is
+// not a valid delimiter list.
+class SplitView {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view*;
+    using reference = const std::string_view&;
+
+    iterator() = default;
+
+    reference operator*() const { return piece_; }
+    pointer operator->() const { return &piece_; }
+
+    iterator& operator++() {
+      Next();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator result = *this;
+      Next();
+      return result;
+    }
+
+    bool operator==(const iterator& other) const {
+      return done_ == other.done_ &&
+             (done_ || (piece_.data() == other.piece_.data() && next_ == other.next_));
+    }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class SplitView;
+
+    explicit iterator(const SplitView* view) : view_(view), done_(false) { Next(); }
+
+    void Next() {
+      const std::string_view& s = view_->s_;
+      if (next_ == std::string_view::npos) {
+        done_ = true;
+        return;
+      }
+      size_t base = next_;
+      if (view_->skip_empty_) {
+        base = view_->delimiters_.FindNot(s, base);
+        if (base == std::string_view::npos) {
+          done_ = true;
+          return;
+        }
+      }
+      if (splits_ == view_->max_splits_) {
+        piece_ = s.substr(base);
+        next_ = std::string_view::npos;
+        return;
+      }
+      size_t found = view_->delimiters_.Find(s, base);
+      piece_ = s.substr(base, found - base);
+      if (found == std::string_view::npos) {
+        next_ = std::string_view::npos;
+      } else {
+        next_ = found + 1;
+        ++splits_;
+      }
+    }
+
+    const SplitView* view_ = nullptr;
+    std::string_view piece_;
+    // Where to look for the next piece, or npos if the current piece is the last.
+    size_t next_ = 0;
+    size_t splits_ = 0;
+    bool done_ = true;
+  };
+  using const_iterator = iterator;
+
+  SplitView(std::string_view s, std::string_view delimiters) : s_(s), delimiters_(delimiters) {}
+
+  // Leaves out empty pieces, as Tokenize does.
+  SplitView& SkipEmpty() & {
+    skip_empty_ = true;
+    return *this;
+  }
+
+  // Splits at no more than `max_splits` delimiters, so that there are at most `max_splits + 1`
+  // pieces.
+  SplitView& MaxSplits(size_t max_splits) & {
+    max_splits_ = max_splits;
+    return *this;
+  }
+
+  // Called on a temporary, as in a range-for loop, these return a copy: a reference to the
+  // temporary wouldn't keep it alive for the loop, and iterators point back at their view.
+  SplitView SkipEmpty() && { return std::move(SkipEmpty()); }
+  SplitView MaxSplits(size_t max_splits) && { return std::move(MaxSplits(max_splits)); }
+
+  iterator begin() const { return iterator(this); }
+  iterator end() const { return iterator(); }
+
+ private:
+  std::string_view s_;
+  internal::DelimiterSet delimiters_;
+  bool skip_empty_ = false;
+  size_t max_splits_ = std::numeric_limits<size_t>::max();
+};
+
 namespace internal {
 template <typename>
 constexpr bool always_false_v = false;
+
+// ASCII whitespace, as isspace() has it in the "C" locale: ' ', '\t', '\n', '\v', '\f' and '\r'.
+inline constexpr std::array<bool, 256> kAsciiSpace = [] {
+  std::array<bool, 256> table = {};
+  for (char ch : {' ', '\t', '\n', '\v', '\f', '\r'}) table[static_cast<unsigned char>(ch)] = true;
+  return table;
+}();
+
+constexpr bool IsAsciiSpace(char ch) {
+  return kAsciiSpace[static_cast<unsigned char>(ch)];
+}
+}  // namespace internal
+
+// Returns `s` without its leading ASCII whitespace.  The result refers to `s`.
+constexpr std::string_view TrimLeft(std::string_view s) {
+  size_t start = 0;
+  while (start < s.size() && internal::IsAsciiSpace(s[start])) ++start;
+  return s.substr(start);
+}
+
+// Returns `s` without its trailing ASCII whitespace.  The result refers to `s`.
+constexpr std::string_view TrimRight(std::string_view s) {
+  size_t end = s.size();
+  while (end > 0 && internal::IsAsciiSpace(s[end - 1])) --end;
+  return s.substr(0, end);
 }
 
+// Returns `s` without its leading and trailing ASCII whitespace.  Unlike Trim, this doesn't copy:
+// the result refers to `s`.
+constexpr std::string_view TrimView(std::string_view s) {
+  return TrimLeft(TrimRight(s));
+}
+
+// Removes leading and trailing ASCII whitespace from `s` itself.
+LIBBASE_EXPORT void TrimInPlace(std::string* s);
+
 template <typename T>
 std::string Trim(T&& t) {
   std::string_view sv;
@@ -74,17 +287,7 @@ std::string Trim(T&& t) {
                   "Implicit conversion to std::string or std::string_view not possible");
   }
 
-  // Skip initial whitespace.
-  while (!sv.empty() && isspace(sv.front())) {
-    sv.remove_prefix(1);
-  }
-
-  // Skip terminating whitespace.
-  while (!sv.empty() && isspace(sv.back())) {
-    sv.remove_suffix(1);
-  }
-
-  return std::string(sv);
+  return std::string(TrimView(sv));
 }
 
 // We instantiate the common cases in strings.cpp.
@@ -99,21 +302,91 @@ extern template std::string Trim(std::string_view&);
 extern template std::string Trim(std::string_view&&);
 #endif
 
-// Joins a container of things into a single string, using the given separator.
-template <typename ContainerT, typename SeparatorT>
-std::string Join(const ContainerT& things, SeparatorT separator) {
-  if (things.empty()) {
-    return "";
+namespace internal {
+
+// Things Join can append as they are: strings of any kind, and single characters.
+template <typename T>
+constexpr bool kJoinsAsString =
+    std::is_convertible_v<const T&, std::string_view> || std::is_same_v<T, char>;
+
+// Things Join formats with std::to_chars rather than a stream.  Other character types stream as
+// characters, so they're left to the stream.
+template <typename T>
+constexpr bool kJoinsAsInteger =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> &&
+    !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char> &&
+    !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>;
+
+template <typename T>
+std::string_view JoinView(const T& thing) {
+  if constexpr (std::is_same_v<T, char>) {
+    return std::string_view(&thing, 1);
+  } else {
+    return thing;
   }
+}
+
+}  // namespace internal
+
+// Appends the things in a container to `result`, separated by the given separator, as Join
+// does.
+//
+// Strings and integers are appended directly: strings after sizing the result once for all of
+// them, integers with std::to_chars.  Anything else is formatted with its operator<<.
+template <typename ContainerT, typename SeparatorT>
+void AppendJoin(std::string* result, const ContainerT& things, const SeparatorT& separator) {
+  using T = std::decay_t<decltype(*things.begin())>;
+  if (things.empty()) return;
 
-  std::ostringstream result;
-  result << *things.begin();
-  for (auto it = std::next(things.begin()); it != things.end(); ++it) {
-    result << separator << *it;
+  if constexpr (internal::kJoinsAsString<SeparatorT> &&
+                (internal::kJoinsAsString<T> || internal::kJoinsAsInteger<T>)) {
+    std::string_view separator_view = internal::JoinView(separator);
+    if constexpr (internal::kJoinsAsString<T>) {
+      size_t size = 0;
+      for (const auto& thing : things) {
+        size += internal::JoinView<T>(thing).size() + separator_view.size();
+      }
+      // Growing geometrically, as appending does, keeps joining onto the same buffer over and
+      // over linear.
+      size_t needed = result->size() + size - separator_view.size();
+      if (needed > result->capacity()) result->reserve(std::max(needed, 2 * result->capacity()));
+      bool first = true;
+      for (const auto& thing : things) {
+        if (!first) result->append(separator_view);
+        first = false;
+        result->append(internal::JoinView<T>(thing));
+      }
+    } else {
+      char buffer[24];
+      bool first = true;
+      for (const auto& thing : things) {
+        if (!first) result->append(separator_view);
+        first = false;
+        char* end = std::to_chars(buffer, buffer + sizeof(buffer), thing).ptr;
+        result->append(buffer, end - buffer);
+      }
+    }
+  } else {
+    std::ostringstream stream;
+    stream << *things.begin();
+    for (auto it = std::next(things.begin()); it != things.end(); ++it) {
+      stream << separator << *it;
+    }
+    result->append(stream.str());
   }
-  return result.str();
 }
 
+// Joins a container of things into a single string, using the given separator.
+template <typename ContainerT, typename SeparatorT>
+std::string Join(const ContainerT& things, SeparatorT separator) {
+  std::string result;
+  AppendJoin(&result, things, separator);
+  return result;
+}
+
+// The *IgnoreCase functions below fold ASCII letters only, whatever the locale, and compare
+// every byte of their arguments, including any NULs.
+
 // Tests whether 's' starts with 'prefix'.
 LIBBASE_EXPORT bool StartsWith(std::string_view s, std::string_view prefix);
 LIBBASE_EXPORT bool StartsWith(std::string_view s, char prefix);
@@ -127,6 +400,15 @@ LIBBASE_EXPORT bool EndsWithIgnoreCase(std::string_view s, std::string_view suff
 // Tests whether 'lhs' equals 'rhs', ignoring case.
 LIBBASE_EXPORT bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs);
 
+// Returns the position of the first occurrence of 'needle' in 'haystack', ignoring case, or
+// std::string_view::npos if there is none.  An empty needle is found at 0.
+LIBBASE_EXPORT size_t FindIgnoreCase(std::string_view haystack, std::string_view needle);
+
+// Tests whether 'haystack' contains 'needle', ignoring case.
+inline bool ContainsIgnoreCase(std::string_view haystack, std::string_view needle) {
+  return FindIgnoreCase(haystack, needle) != std::string_view::npos;
+}
+
 // Removes `prefix` from the start of the given string and returns true (if
 // it was present), false otherwise.
 inline bool ConsumePrefix(std::string_view* s, std::string_view prefix) {
@@ -148,6 +430,55 @@ inline bool ConsumeSuffix(std::string_view* s, std::string_view suffix) {
 [[nodiscard]] LIBBASE_EXPORT std::string StringReplace(std::string_view s, std::string_view from,
                                         std::string_view to, bool all);
 
+// Replaces several strings at once.  A StringReplacer is built once from a list of {from, to}
+// pairs, and then rewrites a string in a single pass, rather than the pass and new string per
+// pair that a series of StringReplace calls costs.  The text is scanned for the first bytes of
+// the `from`s (see internal::DelimiterSet), and a trie of the `from`s is only walked where one
+// is found.
+//
+// Matches don't overlap, and replaced text isn't searched again.  Where several `from`s match at
+// the same position the longest wins, and where the same `from` is given more than once the
+// first pair wins.  Pairs with an empty `from` are ignored.
+//
+// Example:
+//   StringReplacer replacer({{"<", "&lt;"}, {">", "&gt;"}, {"&", "&amp;"}});
+//   replacer.Replace("a<b&c") => "a&lt;b&amp;c"
+class LIBBASE_EXPORT StringReplacer {
+ public:
+  explicit StringReplacer(const std::vector<std::pair<std::string, std::string>>& replacements);
+
+  [[nodiscard]] std::string Replace(std::string_view s) const;
+
+  // Replaces in `s` itself.  If no `to` is longer than its `from`, this is done without
+  // allocating; otherwise the result is built in a new string, as Replace does.
+  void ReplaceInPlace(std::string* s) const;
+
+ private:
+  struct Node {
+    uint32_t first_edge = 0;
+    uint32_t edge_count = 0;
+    // The index in to_ of the replacement for the `from` that ends here, or -1.
+    int32_t replacement = -1;
+  };
+  struct Edge {
+    unsigned char byte;
+    uint32_t target;
+  };
+
+  // Returns the index in to_ of the longest `from` that starts at s[pos], setting *length to its
+  // length, or -1 if none does.
+  int32_t Match(std::string_view s, size_t pos, size_t* length) const;
+
+  // The trie of `from`s, rooted at nodes_[0], with each node's edges sorted by byte.  The root's
+  // edges are also indexed directly by byte (0 meaning none), since every candidate starts there.
+  uint32_t root_[256] = {};
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
+  std::vector<std::string> to_;
+  internal::DelimiterSet first_bytes_;
+  bool grows_ = false;
+};
+
 // Converts an errno number to its error message string.
 LIBBASE_EXPORT std::string ErrnoNumberAsString(int errnum);
 
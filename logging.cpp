@@ -22,11 +22,13 @@
 
 #include "android-base/logging.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #ifndef _MSC_VER
 #include <libgen.h>
 #endif
+#include <string.h>
 #include <time.h>
 
 // For getprogname(3) or program_invocation_short_name.
@@ -36,13 +38,20 @@
 #include <errno.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <filesystem>
@@ -59,13 +68,29 @@
 #endif
 #endif
 
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <android-base/binary_logging.h>
+#include <android-base/chrono_utils.h>
 #include <android-base/file.h>
+#include <android-base/format_logging.h>
+#include <android-base/log_statistics.h>
 #include <android-base/macros.h>
 #include <android-base/parseint.h>
+#include <android-base/string_pool.h>
 #include <android-base/strings.h>
 #include <android-base/threads.h>
 
+#include "bounded_queue.h"
 #include "logging_splitters.h"
+#include "rcu.h"
 
 namespace android {
 namespace base {
@@ -216,54 +241,223 @@ static android_LogPriority LogSeverityToAndroid_LogPriority(LogSeverity severity
     }
 }
 
-static LogFunction& Logger() {
+// The logger and aborter can be replaced while other threads are calling them, so they're only
+// called with an RcuReadLock held.
+static RcuPointer<LogFunction>& Logger() {
 #ifdef __ANDROID__
-  static auto& logger = *new LogFunction(LogdLogger());
+  static auto& logger = *new RcuPointer<LogFunction>(new LogFunction(LogdLogger()));
 #else
-  static auto& logger = *new LogFunction(StderrLogger);
+  static auto& logger = *new RcuPointer<LogFunction>(new LogFunction(StderrLogger));
 #endif
   return logger;
 }
 
-static AbortFunction& Aborter() {
-  static auto& aborter = *new AbortFunction(DefaultAborter);
+static RcuPointer<AbortFunction>& Aborter() {
+  static auto& aborter = *new RcuPointer<AbortFunction>(new AbortFunction(DefaultAborter));
   return aborter;
 }
 
-// Only used for Q fallback.
-static std::recursive_mutex& TagLock() {
-  static auto& tag_lock = *new std::recursive_mutex();
-  return tag_lock;
+static void CallAborter(const char* abort_message) {
+  RcuReadLock lock;
+  (*Aborter().Read())(abort_message);
 }
-// Only used for Q fallback.
-static std::string* gDefaultTag;
+
+// Per-tag minimum severities, set by ANDROID_LOG_TAGS or SetTagMinimumLogSeverity().  ShouldLog()
+// reads the published table under an RcuReadLock; writers rebuild it under TagSeverities::lock and
+// publish the new one.
+class TagSeverityTable {
+ public:
+  TagSeverityTable(const std::unordered_map<InternedString, LogSeverity>& severities,
+                   InternedString default_tag) {
+    size_t size = 2;
+    while (size < severities.size() * 2) size *= 2;
+    slots_.resize(size);
+    for (const auto& [tag, severity] : severities) {
+      size_t i = tag.content_hash();
+      while (slots_[i & (size - 1)].severity != -1) ++i;
+      slots_[i & (size - 1)] = {tag.content_hash(), tag, severity};
+    }
+    default_tag_severity_ = Find(default_tag);
+  }
+
+  // Returns the minimum severity for `tag` (the default tag if null), or -1 if there isn't one.
+  int Find(const char* tag) const {
+    return tag == nullptr ? default_tag_severity_ : Find(std::string_view(tag));
+  }
+
+  int Find(std::string_view tag) const {
+    size_t hash = std::hash<std::string_view>()(tag);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash;; ++i) {
+      const Slot& slot = slots_[i & mask];
+      if (slot.severity == -1 || (slot.hash == hash && slot.tag.view() == tag)) {
+        return slot.severity;
+      }
+    }
+  }
+
+ private:
+  // The tags are interned, so that rebuilding the table for every change to thousands of tags
+  // doesn't copy every one of them again.
+  struct Slot {
+    size_t hash = 0;
+    InternedString tag;
+    int severity = -1;
+  };
+
+  std::vector<Slot> slots_;
+  int default_tag_severity_;
+};
+
+static RcuPointer<const TagSeverityTable> gTagSeverityTable;
+
+// Bumped after every table is published, so that the call sites that cache their tag's minimum
+// severity (see TagSeverityCache) know to look it up again.  Starts at 1, so that 0 never matches.
+static std::atomic<uint64_t> gTagSeverityGeneration{1};
+
+struct TagSeverities {
+  std::mutex lock;
+  // Guarded by lock.
+  std::unordered_map<InternedString, LogSeverity> severities;
+  InternedString default_tag;
+
+  // Must be called with lock held.
+  void Publish() {
+    const TagSeverityTable* table = nullptr;
+    if (!severities.empty()) {
+      table = new TagSeverityTable(severities, default_tag);
+    }
+    gTagSeverityTable.Replace(table);
+    gTagSeverityGeneration.fetch_add(1, std::memory_order_release);
+  }
+};
+
+static TagSeverities& GetTagSeverities() {
+  static auto& tag_severities = *new TagSeverities();
+  return tag_severities;
+}
+
+// Returns the minimum severity for `tag` (the default tag if null), or -1 if there isn't one.
+static int FindTagSeverity(const char* tag) {
+  // Only take the read lock if there's a table to read.
+  if (gTagSeverityTable.Read() == nullptr) return -1;
+  RcuReadLock lock;
+  const TagSeverityTable* tag_severities = gTagSeverityTable.Read();
+  return tag_severities != nullptr ? tag_severities->Find(tag) : -1;
+}
+
+// The tag that a call site on this thread last let through, with its minimum severity as of
+// `generation`, so that ~LogMessage needn't look the same tag up again.  Call sites pass LOG_TAG
+// literals (or null), so a message with the same tag pointer has the same tag.
+struct CallSiteTagSeverity {
+  const char* tag;
+  uint64_t generation;
+  int severity;
+};
+
+static thread_local CallSiteTagSeverity gLastCallSiteTagSeverity = {nullptr, 0, -1};
+
+void SetTagMinimumLogSeverity(const std::string& tag, LogSeverity severity) {
+  TagSeverities& tag_severities = GetTagSeverities();
+  std::lock_guard<std::mutex> lock(tag_severities.lock);
+  tag_severities.severities[StringPool::Global().Intern(tag)] = severity;
+  tag_severities.Publish();
+}
+
+void ClearTagMinimumLogSeverities() {
+  TagSeverities& tag_severities = GetTagSeverities();
+  std::lock_guard<std::mutex> lock(tag_severities.lock);
+  tag_severities.severities.clear();
+  tag_severities.Publish();
+}
+
+// Only used for Q fallback.  Empty means getprogname().  Interned strings are never freed, so
+// readers need no lock.
+static std::atomic<InternedString> gDefaultTag;
 
 void SetDefaultTag(const std::string& tag) {
+  InternedString interned_tag = StringPool::Global().Intern(tag);
+  {
+    TagSeverities& tag_severities = GetTagSeverities();
+    std::lock_guard<std::mutex> lock(tag_severities.lock);
+    tag_severities.default_tag = interned_tag;
+    if (!tag_severities.severities.empty()) tag_severities.Publish();
+  }
+
 #ifndef _MSC_VER
   if (__builtin_available(android 30, *)) {
     __android_log_set_default_tag(tag.c_str());
   } else 
 #endif
   {
-    std::lock_guard<std::recursive_mutex> lock(TagLock());
-    if (gDefaultTag != nullptr) {
-      delete gDefaultTag;
-      gDefaultTag = nullptr;
-    }
-    if (!tag.empty()) {
-      gDefaultTag = new std::string(tag);
-    }
+    gDefaultTag.store(interned_tag, std::memory_order_release);
   }
 }
 
+// The current thread's ScopedLogContext fields, rendered as "key=value key=value".  Trivially
+// destructible, so it can be used while the thread exits.
+struct LogContextState {
+  char text[ScopedLogContext::kMaxSize];
+  size_t size = 0;
+  size_t fields = 0;
+};
+
+static thread_local LogContextState gLogContext;
+
+void ScopedLogContext::Push(std::string_view key, std::string_view value) {
+  LogContextState& context = gLogContext;
+  saved_size_ = context.size;
+  size_t separator = context.size == 0 ? 0 : 1;
+  size_t field_size = separator + key.size() + 1 + value.size();
+  pushed_ = context.fields < kMaxFields && field_size <= sizeof(context.text) - context.size;
+  if (!pushed_) return;
+
+  char* p = context.text + context.size;
+  if (separator != 0) *p++ = ' ';
+  p = std::copy(key.begin(), key.end(), p);
+  *p++ = '=';
+  std::copy(value.begin(), value.end(), p);
+  context.size += field_size;
+  ++context.fields;
+}
+
+ScopedLogContext::~ScopedLogContext() {
+  if (!pushed_) return;
+  gLogContext.size = saved_size_;
+  --gLogContext.fields;
+}
+
+std::string_view GetLogContext() {
+  return std::string_view(gLogContext.text, gLogContext.size);
+}
+
+// Makes the current thread's context `context` until destroyed, so that a logger that writes
+// messages on behalf of other threads (AsyncLogger) can pass their context on.
+class ScopedLogContextOverride {
+ public:
+  explicit ScopedLogContextOverride(std::string_view context) : saved_(gLogContext) {
+    size_t size = std::min(context.size(), sizeof(gLogContext.text));
+    std::copy(context.begin(), context.begin() + size, gLogContext.text);
+    gLogContext.size = size;
+    gLogContext.fields = 0;
+  }
+
+  ~ScopedLogContextOverride() { gLogContext = saved_; }
+
+ private:
+  LogContextState saved_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLogContextOverride);
+};
+
 static bool gInitialized = false;
 
 // Only used for Q fallback.
-static LogSeverity gMinimumLogSeverity = VERBOSE;
+static std::atomic<LogSeverity> gMinimumLogSeverity{VERBOSE};
 
 #if defined(__linux__)
-static void KernelLogLine(const char* msg, int length, android::base::LogSeverity severity,
-                          const char* tag) {
+void KernelLogger(android::base::LogId, android::base::LogSeverity severity, const char* tag,
+                  const char*, unsigned int, const char* full_message) {
   // clang-format off
   static constexpr int kLogSeverityToKernelLogLevel[] = {
       [android::base::VERBOSE] = 7,              // KERN_DEBUG (there is no verbose kernel log
@@ -282,46 +476,122 @@ static void KernelLogLine(const char* msg, int length, android::base::LogSeverit
   static int klog_fd = OpenKmsg();
   if (klog_fd == -1) return;
 
-  int level = kLogSeverityToKernelLogLevel[severity];
+  auto write_record = [](struct iovec* iov, int count) {
+    TEMP_FAILURE_RETRY(writev(klog_fd, iov, count));
+  };
+  KernelLogRecords(kLogSeverityToKernelLogLevel[severity], tag, GetLogContext(), full_message,
+                   write_record);
+}
+#endif
 
-  // The kernel's printk buffer is only |1024 - PREFIX_MAX| bytes, where
-  // PREFIX_MAX could be 48 or 32.
-  // Reference: kernel/printk/printk.c
-  static constexpr int LOG_LINE_MAX = 1024 - 48;
-  char buf[LOG_LINE_MAX] __attribute__((__uninitialized__));
-  size_t size = snprintf(buf, sizeof(buf), "<%d>%s: %.*s\n", level, tag, length, msg);
-  TEMP_FAILURE_RETRY(write(klog_fd, buf, std::min(size, sizeof(buf))));
+#if !defined(_WIN32)
+static std::mutex& StderrLock() {
+  static auto& lock = *new std::mutex();
+  return lock;
+}
 
-  if (size > sizeof(buf)) {
-    size_t truncated = size - sizeof(buf);
-    size = snprintf(
-        buf, sizeof(buf),
-        "<%d>%s: **previous message missing %zu bytes** %zu-byte message too long for printk\n",
-        level, tag, truncated, size);
-    TEMP_FAILURE_RETRY(write(klog_fd, buf, std::min(size, sizeof(buf))));
+// Writes all of the given iovecs, coping with short writes.  There's nothing useful to do if
+// stderr is broken, so errors are ignored.
+static void WriteFully(int fd, struct iovec* iov, int count) {
+  while (count > 0) {
+    ssize_t written = writev(fd, iov, count);
+    if (written == -1 && errno == EINTR) continue;
+    if (written <= 0) return;
+    while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
   }
 }
+#endif
 
-void KernelLogger(android::base::LogId, android::base::LogSeverity severity, const char* tag,
-                  const char*, unsigned int, const char* full_message) {
-  SplitByLines(full_message, KernelLogLine, severity, tag);
+static std::atomic<LogTimestampFormat> gStderrTimestampFormat{LogTimestampFormat::kSeconds};
+
+LogTimestampFormat SetStderrLogTimestampFormat(LogTimestampFormat format) {
+  return gStderrTimestampFormat.exchange(format, std::memory_order_relaxed);
 }
+
+// Formats the current time for StderrLogger, as "%m-%d %H:%M:%S" plus any fraction of a second that
+// the configured format asks for.  localtime_r() takes a process-wide lock (in glibc) and
+// strftime() is slow, so each thread only calls them when the second changes, and reuses the
+// text otherwise.
+static void FormatStderrTimestamp(char (&buffer)[32]) {
+  LogTimestampFormat format = gStderrTimestampFormat.load(std::memory_order_relaxed);
+  struct timespec ts;
+#if defined(_WIN32)
+  timespec_get(&ts, TIME_UTC);
+#elif defined(CLOCK_REALTIME_COARSE)
+  // The coarse clock is much cheaper, and its resolution (the scheduler tick) is plenty for
+  // anything coarser than microseconds.
+  clockid_t clock =
+      format == LogTimestampFormat::kMicroseconds ? CLOCK_REALTIME : CLOCK_REALTIME_COARSE;
+  clock_gettime(clock, &ts);
+#else
+  clock_gettime(CLOCK_REALTIME, &ts);
 #endif
 
+  struct SecondCache {
+    time_t second = -1;
+    size_t size = 0;
+    char text[sizeof(buffer)];
+  };
+  static thread_local SecondCache cache;
+  if (ts.tv_sec != cache.second) {
+    struct tm now;
+#if defined(_WIN32)
+    localtime_s(&now, &ts.tv_sec);
+#else
+    localtime_r(&ts.tv_sec, &now);
+#endif
+    cache.size = strftime(cache.text, sizeof(cache.text), "%m-%d %H:%M:%S", &now);
+    cache.second = ts.tv_sec;
+  }
+
+  memcpy(buffer, cache.text, cache.size);
+  char* fraction = buffer + cache.size;
+  size_t fraction_size = sizeof(buffer) - cache.size;
+  switch (format) {
+    case LogTimestampFormat::kSeconds:
+      *fraction = '\0';
+      break;
+    case LogTimestampFormat::kMilliseconds:
+      snprintf(fraction, fraction_size, ".%03ld", static_cast<long>(ts.tv_nsec / 1000000));
+      break;
+    case LogTimestampFormat::kMicroseconds:
+      snprintf(fraction, fraction_size, ".%06ld", static_cast<long>(ts.tv_nsec / 1000));
+      break;
+  }
+}
+
 void StderrLogger(LogId, LogSeverity severity, const char* tag, const char* file, unsigned int line,
                   const char* message) {
-  struct tm now;
-  time_t t = time(nullptr);
+  char timestamp[32];
+  FormatStderrTimestamp(timestamp);
+  StderrLinePrefix line_prefix(timestamp, getpid(), GetThreadId(), severity, tag, file, line,
+                               GetLogContext());
 
 #if defined(_WIN32)
-  localtime_s(&now, &t);
-#else
-  localtime_r(&t, &now);
-#endif
-  auto output_string =
-      StderrOutputGenerator(now, getpid(), GetThreadId(), severity, tag, file, line, message);
+  auto output_string = StderrOutputGenerator(line_prefix, message);
 
   fputs(output_string.c_str(), stderr);
+#else
+  // Write straight to the file descriptor rather than through stdio (stderr is unbuffered anyway),
+  // usually with a single writev() per message.  A single writev() is only atomic for pipes up to
+  // PIPE_BUF bytes, and a message may need more than one, so the whole message is written under
+  // the lock that stdio's FILE lock used to provide.
+  int fd = fileno(stderr);
+  std::unique_lock<std::mutex> lock(StderrLock(), std::defer_lock);
+  auto write_iovecs = [&](struct iovec* iov, int count, bool) {
+    if (!lock.owns_lock()) lock.lock();
+    WriteFully(fd, iov, count);
+  };
+  StderrOutputIovecs(line_prefix, message, write_iovecs);
+#endif
 }
 
 void StdioLogger(LogId, LogSeverity severity, const char* /*tag*/, const char* /*file*/,
@@ -343,7 +613,8 @@ void DefaultAborter(const char* abort_message) {
   abort();
 }
 
-static void LogdLogChunk(LogId id, LogSeverity severity, const char* tag, const char* message) {
+static void LogdLogChunk(LogId id, LogSeverity severity, const char* tag, const char* message,
+                         size_t) {
   int32_t lg_id = LogIdTolog_id_t(id);
   int32_t priority = LogSeverityToPriority(severity);
 
@@ -377,7 +648,561 @@ void LogdLogger::operator()(LogId id, LogSeverity severity, const char* tag, con
   return;
 #endif
 
-  SplitByLogdChunks(id, severity, tag, file, line, message, LogdLogChunk);
+  SplitByLogdChunks(id, severity, tag, file, line, GetLogContext(), message, strlen(message),
+                    LogdLogChunk);
+}
+
+// Consumers (the writer thread, synchronous FATAL writes and Flush()) serialize on sink_lock so
+// that the wrapped logger sees messages in queue order.  It is recursive so that a wrapped logger
+// which itself logs a FATAL message doesn't deadlock.
+//
+// The writer thread holds its own reference to the state, and the AsyncLoggers' references only
+// stop it (see AsyncLogger::AsyncLogger).  The last AsyncLogger can go away on the writer thread
+// itself, when the wrapped logger calls SetLogger(), and the writer must still finish its loop.
+struct AsyncLogger::State {
+  struct Record {
+    LogId id;
+    LogSeverity severity;
+    unsigned int line;
+    bool has_tag;
+    bool has_file;
+    std::string tag;
+    std::string file;
+    std::string message;
+    // The logging thread's ScopedLogContext fields.
+    std::string context;
+  };
+
+  State(LogFunction&& logger, size_t capacity, OverflowPolicy policy)
+      : logger(std::move(logger)), policy(policy), queue(capacity) {}
+
+  void Start(std::shared_ptr<State> self) {
+    writer = std::thread([self = std::move(self)] { self->WriterLoop(); });
+  }
+
+  // Lets the writer thread drain what's left and exit, and waits for it unless this is it.
+  void Stop() {
+    doorbell.Close();
+    if (std::this_thread::get_id() == writer.get_id()) {
+      writer.detach();
+    } else {
+      writer.join();
+    }
+  }
+
+  void Write(const Record& record) {
+    const char* tag = record.has_tag ? record.tag.c_str() : nullptr;
+    uint64_t dropped_now = dropped.load(std::memory_order_relaxed);
+    if (dropped_now != reported_dropped) {
+      logger(record.id, WARNING, tag, nullptr, 0,
+             StringPrintf("AsyncLogger dropped %" PRIu64 " messages",
+                          dropped_now - reported_dropped)
+                 .c_str());
+      reported_dropped = dropped_now;
+    }
+    ScopedLogContextOverride context(record.context);
+    logger(record.id, record.severity, tag, record.has_file ? record.file.c_str() : nullptr,
+           record.line, record.message.c_str());
+  }
+
+  // Must be called with sink_lock held.  Writes every message queued before the call, including
+  // any that another thread is still copying into the queue.  Records are swapped out of their
+  // slot before being written so that a slow logger never holds a slot, and so that their
+  // strings' capacity is recycled.  A FATAL message logged by the wrapped logger drains
+  // recursively, which needs its own scratch record.
+  void Drain() {
+    size_t end = queue.PushPosition();
+    Record nested;
+    Record& record = draining ? nested : scratch;
+    bool outermost = !draining;
+    draining = true;
+    while (queue.PopBefore(end, [&record](Record& queued) { std::swap(record, queued); })) {
+      Write(record);
+    }
+    if (outermost) draining = false;
+  }
+
+  void WriterLoop() {
+    writer_id = std::this_thread::get_id();
+    do {
+      std::lock_guard<std::recursive_mutex> lock(sink_lock);
+      Drain();
+    } while (doorbell.Wait([this] { return !queue.IsEmpty(); }));
+
+    std::lock_guard<std::recursive_mutex> lock(sink_lock);
+    Drain();
+  }
+
+  LogFunction logger;
+  const OverflowPolicy policy;
+  BoundedQueue<Record> queue;
+  Doorbell doorbell;
+  std::atomic<uint64_t> dropped{0};
+  std::recursive_mutex sink_lock;
+  // Guarded by sink_lock.
+  uint64_t reported_dropped = 0;
+  Record scratch;
+  bool draining = false;
+  std::atomic<std::thread::id> writer_id{};
+  std::thread writer;
+};
+
+AsyncLogger::AsyncLogger(LogFunction&& logger, size_t capacity, OverflowPolicy policy) {
+  auto state = std::make_shared<State>(std::move(logger), capacity, policy);
+  state->Start(state);
+  // When the last copy of this logger goes away, the writer thread is stopped; its own reference
+  // keeps the state alive until it has finished with it.
+  state_ = std::shared_ptr<State>(state.get(), [state](State*) { state->Stop(); });
+}
+
+void AsyncLogger::operator()(LogId id, LogSeverity severity, const char* tag, const char* file,
+                             unsigned int line, const char* message) {
+  State* state = state_.get();
+
+  // Messages that precede an abort must be on their way out before we return, and the writer
+  // thread can't wait on itself for room in the queue.
+  if (severity >= FATAL_WITHOUT_ABORT ||
+      std::this_thread::get_id() == state->writer_id.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::recursive_mutex> lock(state->sink_lock);
+    state->Drain();
+    state->logger(id, severity, tag, file, line, message);
+    return;
+  }
+
+  auto fill = [&](State::Record& record) {
+    record.id = id;
+    record.severity = severity;
+    record.line = line;
+    record.has_tag = tag != nullptr;
+    record.tag.assign(tag != nullptr ? tag : "");
+    record.has_file = file != nullptr;
+    record.file.assign(file != nullptr ? file : "");
+    record.message.assign(message);
+    record.context.assign(GetLogContext());
+  };
+
+  while (!state->queue.TryPush(fill)) {
+    switch (state->policy) {
+      case OverflowPolicy::kBlock:
+        state->doorbell.Ring();
+        std::this_thread::yield();
+        break;
+      case OverflowPolicy::kDropOldest:
+        if (state->queue.TryPop([](State::Record&) {})) {
+          state->dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          std::this_thread::yield();
+        }
+        break;
+      case OverflowPolicy::kDropNewest:
+        state->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+  }
+  state->doorbell.Ring();
+}
+
+void AsyncLogger::Flush() {
+  std::lock_guard<std::recursive_mutex> lock(state_->sink_lock);
+  state_->Drain();
+}
+
+uint64_t AsyncLogger::GetDroppedCount() const {
+  return state_->dropped.load(std::memory_order_relaxed);
+}
+
+// As with AsyncLogger, the background thread holds its own reference to the state, and the
+// FileLoggers' references only stop it: the last FileLogger can go away on the background thread,
+// when `compress` calls SetLogger(), and that thread must still finish its loop.
+struct FileLogger::State {
+  State(const std::string& path, const Options& options) : path(path), options(options) {
+    std::lock_guard<std::mutex> guard(lock);
+    OpenFile();
+  }
+
+  ~State() {
+    WriteBuffer(buffer.size());
+    if (fd != -1) close(fd);
+  }
+
+  void Start(std::shared_ptr<State> self) {
+    background = std::thread([self = std::move(self)] { self->BackgroundLoop(); });
+  }
+
+  // Lets the background thread process what's left and exit, and waits for it unless this is it.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    work_cv.notify_all();
+    if (std::this_thread::get_id() == background.get_id()) {
+      background.detach();
+    } else {
+      background.join();
+    }
+  }
+
+  // The following must be called with lock held.
+
+  void OpenFile() {
+#if defined(_WIN32)
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_BINARY, 0644);
+#else
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    file_size = 0;
+    struct stat st;
+    if (fd != -1 && fstat(fd, &st) == 0) {
+      file_size = st.st_size;
+    }
+#if defined(__linux__)
+    // FALLOC_FL_KEEP_SIZE reserves the blocks without moving the end of the file, which is where
+    // O_APPEND writes go.
+    if (fd != -1 && options.preallocate_size > static_cast<uint64_t>(file_size)) {
+      fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, options.preallocate_size);
+    }
+#endif
+
+    UpdateNextRotation();
+  }
+
+  void UpdateNextRotation() {
+    next_rotation = std::numeric_limits<time_t>::max();
+    if (options.rotation_interval.count() > 0) {
+      time_t interval = options.rotation_interval.count();
+      next_rotation = (time(nullptr) / interval + 1) * interval;
+    }
+  }
+
+  // Writes the first `size` bytes of the buffer to the file, and removes them from the buffer.
+  void WriteBuffer(size_t size) {
+    const char* data = buffer.data();
+    size_t remaining = size;
+    while (fd != -1 && remaining > 0) {
+      ssize_t written = write(fd, data, remaining);
+      if (written == -1 && errno == EINTR) continue;
+      if (written <= 0) break;
+      data += written;
+      remaining -= written;
+      file_size += written;
+    }
+    if (remaining > 0) {
+      // The file is unusable, so salvage what we can.
+      fwrite(data, 1, remaining, stderr);
+    }
+    buffer.erase(0, size);
+  }
+
+  void Rotate() {
+    if (fd != -1) close(fd);
+    fd = -1;
+
+    char timestamp[32];
+    time_t t = time(nullptr);
+    struct tm now;
+#if defined(_WIN32)
+    localtime_s(&now, &t);
+#else
+    localtime_r(&t, &now);
+#endif
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &now);
+    // Several rotations in the same second need distinct names.  We can't rely on the file system
+    // to tell us which names are taken, because `compress` may have renamed earlier files.
+    if (t != last_rotation) {
+      last_rotation = t;
+      rotations_this_second = 0;
+    }
+    std::string rotated_path;
+    std::error_code ec;
+    do {
+      rotated_path = path + "." + timestamp;
+      if (rotations_this_second != 0) rotated_path += StringPrintf("-%d", rotations_this_second);
+      ++rotations_this_second;
+    } while (std::filesystem::exists(rotated_path, ec));
+
+    if (rename(path.c_str(), rotated_path.c_str()) == 0) {
+      to_process.push_back(std::move(rotated_path));
+      work_cv.notify_one();
+    }
+    OpenFile();
+  }
+
+  void Log(LogSeverity severity, const char* tag, const char* file, unsigned int line,
+           const char* message) {
+    char timestamp[32];
+    FormatStderrTimestamp(timestamp);
+    StderrLinePrefix line_prefix(timestamp, getpid(), GetThreadId(), severity, tag, file, line,
+                                 GetLogContext());
+
+    std::lock_guard<std::mutex> guard(lock);
+    size_t old_size = buffer.size();
+    auto append_line = [this, &line_prefix](const char* line, int size) {
+      buffer.append(line_prefix.data(), line_prefix.size());
+      if (size == -1) {
+        buffer.append(line);
+      } else {
+        buffer.append(line, size);
+      }
+      buffer.push_back('\n');
+    };
+    SplitByLines(message, append_line);
+
+    // An empty file is never worth rotating.
+    bool empty = file_size + old_size == 0;
+    bool expired = next_rotation != std::numeric_limits<time_t>::max() &&
+                   time(nullptr) >= next_rotation;
+    if (!empty && (expired || (options.max_file_size != 0 &&
+                               file_size + buffer.size() > options.max_file_size))) {
+      WriteBuffer(old_size);
+      Rotate();
+    } else if (expired) {
+      UpdateNextRotation();
+    }
+    if (buffer.size() >= options.buffer_size || severity >= ERROR) {
+      WriteBuffer(buffer.size());
+    } else if (old_size == 0 && options.flush_interval.count() > 0) {
+      // Start the clock on these messages.
+      work_cv.notify_one();
+    }
+  }
+
+  void BackgroundLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+      if (to_process.empty() && !stopping) {
+        if (!buffer.empty() && options.flush_interval.count() > 0) {
+          work_cv.wait_for(guard, options.flush_interval);
+          WriteBuffer(buffer.size());
+        } else {
+          work_cv.wait(guard);
+        }
+        continue;
+      }
+      if (to_process.empty()) break;
+
+      std::string rotated_path = std::move(to_process.front());
+      to_process.pop_front();
+      processing = true;
+      guard.unlock();
+
+      if (options.compress) {
+        rotated_path = options.compress(rotated_path);
+      }
+      rotated_files.push_back(std::move(rotated_path));
+      while (options.max_rotated_files != 0 && rotated_files.size() > options.max_rotated_files) {
+        remove(rotated_files.front().c_str());
+        rotated_files.pop_front();
+      }
+
+      guard.lock();
+      processing = false;
+      idle_cv.notify_all();
+    }
+  }
+
+  const std::string path;
+  const Options options;
+
+  std::mutex lock;
+  std::condition_variable work_cv;
+  std::condition_variable idle_cv;
+  // Guarded by lock.
+  int fd = -1;
+  uint64_t file_size = 0;
+  time_t next_rotation;
+  time_t last_rotation = 0;
+  int rotations_this_second = 0;
+  std::string buffer;
+  std::deque<std::string> to_process;
+  bool processing = false;
+  bool stopping = false;
+
+  // Only used by the background thread.
+  std::deque<std::string> rotated_files;
+  std::thread background;
+};
+
+FileLogger::FileLogger(const std::string& path) : FileLogger(path, Options()) {}
+
+FileLogger::FileLogger(const std::string& path, const Options& options) {
+  auto state = std::make_shared<State>(path, options);
+  state->Start(state);
+  // When the last copy of this logger goes away, the background thread is stopped; its own
+  // reference keeps the state alive until it has finished with it.
+  state_ = std::shared_ptr<State>(state.get(), [state](State*) { state->Stop(); });
+}
+
+void FileLogger::operator()(LogId, LogSeverity severity, const char* tag, const char* file,
+                            unsigned int line, const char* message) {
+  state_->Log(severity, tag, file, line, message);
+}
+
+void FileLogger::Flush() {
+  State* state = state_.get();
+  std::unique_lock<std::mutex> guard(state->lock);
+  state->WriteBuffer(state->buffer.size());
+  state->idle_cv.wait(guard, [state] { return state->to_process.empty() && !state->processing; });
+}
+
+namespace {
+
+struct BinaryLogRecord {
+  const char* file;
+  unsigned int line;
+  LogSeverity severity;
+  const char* tag;
+  log_detail::BinaryLogDecoder decoder;
+  const char* format;
+  size_t format_size;
+  size_t args_size;
+  char args[log_detail::kBinaryLogArgsSize];
+};
+
+// LOGB messages are queued here and formatted by a background thread.  drain_lock_ serializes that
+// thread with FlushBinaryLogs() so that messages reach the logger in queue order.  It is recursive
+// so that a logger which itself logs a FATAL message doesn't deadlock.
+//
+// The queue lives for the life of the process, except that the background thread doesn't survive
+// fork(): a child process that uses LOGB starts over with a queue of its own.
+class BinaryLogQueue {
+ public:
+  static BinaryLogQueue* Get() {
+    BinaryLogQueue* queue = current_.load(std::memory_order_acquire);
+    if (queue == nullptr) {
+      std::lock_guard<std::mutex> lock(CreationLock());
+      queue = current_.load(std::memory_order_relaxed);
+      if (queue == nullptr) {
+        queue = new BinaryLogQueue;
+        current_.store(queue, std::memory_order_release);
+      }
+    }
+    return queue;
+  }
+
+  static BinaryLogQueue* GetIfCreated() { return current_.load(std::memory_order_acquire); }
+
+  template <typename F>
+  void Push(F&& fill) {
+    while (!queue_.TryPush(fill)) {
+      doorbell_.Ring();
+      std::this_thread::yield();
+    }
+    doorbell_.Ring();
+  }
+
+  void Flush() {
+    std::lock_guard<std::recursive_mutex> lock(drain_lock_);
+    Drain();
+  }
+
+ private:
+  static constexpr size_t kCapacity = 1024;
+
+  BinaryLogQueue() : queue_(kCapacity) {
+#if !defined(_WIN32)
+    static bool registered_atfork = false;
+    if (!registered_atfork) {
+      pthread_atfork([] { CreationLock().lock(); }, [] { CreationLock().unlock(); },
+                     [] {
+                       current_.store(nullptr, std::memory_order_relaxed);
+                       CreationLock().unlock();
+                     });
+      registered_atfork = true;
+    }
+#endif
+    std::thread([this] { Run(); }).detach();
+  }
+
+  static std::mutex& CreationLock() {
+    static auto& lock = *new std::mutex();
+    return lock;
+  }
+
+  void Run() {
+    do {
+      Flush();
+    } while (doorbell_.Wait([this] { return !queue_.IsEmpty(); }));
+  }
+
+  // Must be called with drain_lock_ held.  Formats every message queued before the call,
+  // including any that another thread is still copying into the queue.
+  void Drain() {
+    size_t end = queue_.PushPosition();
+    BinaryLogRecord record;
+    fmt::memory_buffer message;
+    while (queue_.PopBefore(end, [&record](const BinaryLogRecord& queued) {
+      memcpy(&record, &queued, offsetof(BinaryLogRecord, args) + queued.args_size);
+    })) {
+      message.clear();
+      record.decoder(message, fmt::string_view(record.format, record.format_size), record.args);
+      message.push_back('\0');
+      LogMessage::LogLine(GetFileBasename(record.file), record.line, record.severity, record.tag,
+                          message.data());
+    }
+  }
+
+  static std::atomic<BinaryLogQueue*> current_;
+
+  BoundedQueue<BinaryLogRecord> queue_;
+  Doorbell doorbell_;
+  std::recursive_mutex drain_lock_;
+};
+
+std::atomic<BinaryLogQueue*> BinaryLogQueue::current_{nullptr};
+
+}  // namespace
+
+void LogBinary(const char* file, unsigned int line, LogSeverity severity, const char* tag,
+               log_detail::BinaryLogDecoder decoder, fmt::string_view format, const char* args,
+               size_t args_size) {
+  BinaryLogQueue::Get()->Push([&](BinaryLogRecord& record) {
+    record.file = file;
+    record.line = line;
+    record.severity = severity;
+    record.tag = tag;
+    record.decoder = decoder;
+    record.format = format.data();
+    record.format_size = format.size();
+    record.args_size = args_size;
+    memcpy(record.args, args, args_size);
+  });
+}
+
+void FlushBinaryLogs() {
+  BinaryLogQueue* queue = BinaryLogQueue::GetIfCreated();
+  if (queue != nullptr) {
+    queue->Flush();
+  }
+}
+
+static bool ParseLogTagsSeverity(char level, LogSeverity* severity) {
+  switch (level) {
+    case 'v':
+      *severity = VERBOSE;
+      return true;
+    case 'd':
+      *severity = DEBUG;
+      return true;
+    case 'i':
+      *severity = INFO;
+      return true;
+    case 'w':
+      *severity = WARNING;
+      return true;
+    case 'e':
+      *severity = ERROR;
+      return true;
+    case 'f':
+      *severity = FATAL_WITHOUT_ABORT;
+      return true;
+    // liblog will even suppress FATAL if you say 's' for silent, but fatal should
+    // never be suppressed.
+    case 's':
+      *severity = FATAL_WITHOUT_ABORT;
+      return true;
+  }
+  return false;
 }
 
 void InitLogging(char* argv[], LogFunction&& logger, AbortFunction&& aborter) {
@@ -408,45 +1233,31 @@ void InitLogging(char* argv[], LogFunction&& logger, AbortFunction&& aborter) {
     return;
   }
 
-  std::vector<std::string> specs = Split(tags, " ");
-  for (size_t i = 0; i < specs.size(); ++i) {
-    // "tag-pattern:[vdiwefs]"
-    std::string spec(specs[i]);
-    if (spec.size() == 3 && StartsWith(spec, "*:")) {
-      switch (spec[2]) {
-        case 'v':
-          SetMinimumLogSeverity(VERBOSE);
-          continue;
-        case 'd':
-          SetMinimumLogSeverity(DEBUG);
-          continue;
-        case 'i':
-          SetMinimumLogSeverity(INFO);
-          continue;
-        case 'w':
-          SetMinimumLogSeverity(WARNING);
-          continue;
-        case 'e':
-          SetMinimumLogSeverity(ERROR);
-          continue;
-        case 'f':
-          SetMinimumLogSeverity(FATAL_WITHOUT_ABORT);
-          continue;
-        // liblog will even suppress FATAL if you say 's' for silent, but fatal should
-        // never be suppressed.
-        case 's':
-          SetMinimumLogSeverity(FATAL_WITHOUT_ABORT);
-          continue;
-      }
+  for (const std::string& spec : Split(tags, " ")) {
+    if (spec.empty()) continue;
+
+    // "tag-pattern[:[vdiwefs]]", where a missing level means 'v' as it does for logcat.
+    size_t colon = spec.rfind(':');
+    std::string tag = spec.substr(0, colon);
+    LogSeverity severity = VERBOSE;
+    if (tag.empty() ||
+        (colon != std::string::npos &&
+         (colon + 2 != spec.size() || !ParseLogTagsSeverity(spec[colon + 1], &severity)))) {
+      LOG(FATAL) << "unsupported '" << spec << "' in ANDROID_LOG_TAGS (" << tags << ")";
+    }
+    if (tag == "*") {
+      SetMinimumLogSeverity(severity);
+    } else {
+      SetTagMinimumLogSeverity(tag, severity);
     }
-    LOG(FATAL) << "unsupported '" << spec << "' in ANDROID_LOG_TAGS (" << tags
-               << ")";
   }
 }
 
 LogFunction SetLogger(LogFunction&& logger) {
-  LogFunction old_logger = std::move(Logger());
-  Logger() = std::move(logger);
+  // Other threads may still be calling the old logger, so it has to be copied rather than moved.
+  LogFunction* old = Logger().Exchange(new LogFunction(std::move(logger)));
+  LogFunction old_logger = *old;
+  RcuPointer<LogFunction>::Retire(old);
 
 #ifndef _MSC_VER
   if (__builtin_available(android 30, *)) 
@@ -456,37 +1267,214 @@ LogFunction SetLogger(LogFunction&& logger) {
       auto log_id = log_id_tToLogId(log_message->buffer_id);
       auto severity = PriorityToLogSeverity(log_message->priority);
 
-      Logger()(log_id, severity, log_message->tag, log_message->file, log_message->line,
-               log_message->message);
+      RcuReadLock lock;
+      (*Logger().Read())(log_id, severity, log_message->tag, log_message->file, log_message->line,
+                         log_message->message);
     });
   }
   return old_logger;
 }
 
 AbortFunction SetAborter(AbortFunction&& aborter) {
-  AbortFunction old_aborter = std::move(Aborter());
-  Aborter() = std::move(aborter);
+  AbortFunction* old = Aborter().Exchange(new AbortFunction(std::move(aborter)));
+  AbortFunction old_aborter = *old;
+  RcuPointer<AbortFunction>::Retire(old);
 #ifndef _MSC_VER
   if (__builtin_available(android 30, *))
 #endif
   {
-    __android_log_set_aborter([](const char* abort_message) { Aborter()(abort_message); });
+    __android_log_set_aborter(CallAborter);
   }
   return old_aborter;
 }
 
+// Messages are built in plain character buffers that are recycled through a per-thread cache, so
+// that once a thread has logged a few messages, logging no longer touches the allocator.  The
+// LogMessageData objects themselves are recycled the same way.  A cache holds a few of each rather
+// than just one because a message can be built while another is in progress on the same thread,
+// for example when an operator<< itself logs.
+class LogBufferCache {
+ public:
+  static constexpr size_t kInitialBufferSize = 256;
+
+  struct Buffer {
+    Buffer* next = nullptr;
+    size_t capacity = 0;
+    std::unique_ptr<char[]> data;
+  };
+
+  static Buffer* AcquireBuffer() {
+    LogBufferCache* cache = Get();
+    if (cache != nullptr && cache->buffers_ != nullptr) {
+      Buffer* buffer = cache->buffers_;
+      cache->buffers_ = buffer->next;
+      --cache->buffer_count_;
+      return buffer;
+    }
+    Buffer* buffer = new Buffer;
+    buffer->capacity = kInitialBufferSize;
+    buffer->data.reset(new char[buffer->capacity]);
+    return buffer;
+  }
+
+  static void ReleaseBuffer(Buffer* buffer) {
+    LogBufferCache* cache = Get();
+    // Don't let one huge message pin its buffer for the rest of the thread's life.
+    if (cache == nullptr || cache->buffer_count_ == kMaxCached ||
+        buffer->capacity > kMaxBufferSize) {
+      delete buffer;
+      return;
+    }
+    buffer->next = cache->buffers_;
+    cache->buffers_ = buffer;
+    ++cache->buffer_count_;
+  }
+
+  static void* AcquireBlock(size_t size) {
+    LogBufferCache* cache = Get();
+    if (cache != nullptr && cache->blocks_ != nullptr) {
+      Block* block = cache->blocks_;
+      cache->blocks_ = block->next;
+      --cache->block_count_;
+      return block;
+    }
+    return ::operator new(std::max(size, sizeof(Block)));
+  }
+
+  static void ReleaseBlock(void* p) {
+    LogBufferCache* cache = Get();
+    if (cache == nullptr || cache->block_count_ == kMaxCached) {
+      ::operator delete(p);
+      return;
+    }
+    Block* block = static_cast<Block*>(p);
+    block->next = cache->blocks_;
+    cache->blocks_ = block;
+    ++cache->block_count_;
+  }
+
+ private:
+  static constexpr size_t kMaxCached = 4;
+  static constexpr size_t kMaxBufferSize = 64 * 1024;
+
+  struct Block {
+    Block* next;
+  };
+
+  LogBufferCache() = default;
+
+  ~LogBufferCache() {
+    while (buffers_ != nullptr) {
+      Buffer* next = buffers_->next;
+      delete buffers_;
+      buffers_ = next;
+    }
+    while (blocks_ != nullptr) {
+      Block* next = blocks_->next;
+      ::operator delete(blocks_);
+      blocks_ = next;
+    }
+    destroyed_ = true;
+  }
+
+  // Returns null once the calling thread's cache has been destroyed: code that runs during thread
+  // exit can still log, it just doesn't get the benefit of the cache.
+  static LogBufferCache* Get() {
+    if (destroyed_) return nullptr;
+    // The cache has to be destroyed when its thread exits, or every thread that ever logged would
+    // leak its buffers.
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+    static thread_local LogBufferCache cache;
+#pragma clang diagnostic pop
+    return &cache;
+  }
+
+  static thread_local bool destroyed_;
+
+  Buffer* buffers_ = nullptr;
+  size_t buffer_count_ = 0;
+  Block* blocks_ = nullptr;
+  size_t block_count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LogBufferCache);
+};
+
+thread_local bool LogBufferCache::destroyed_ = false;
+
+// A streambuf that writes straight into a LogBufferCache buffer, growing it as needed.  One byte
+// is always held back so that the message can be NUL-terminated in place.
+class LogStreamBuf : public std::streambuf {
+ public:
+  LogStreamBuf() : buffer_(LogBufferCache::AcquireBuffer()) { Reset(0); }
+
+  ~LogStreamBuf() override { LogBufferCache::ReleaseBuffer(buffer_); }
+
+  // Returns the NUL-terminated message.
+  const char* c_str() {
+    *pptr() = '\0';
+    return pbase();
+  }
+
+ protected:
+  int_type overflow(int_type ch) override {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+      return traits_type::not_eof(ch);
+    }
+    Grow(1);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (n > epptr() - pptr()) {
+      Grow(static_cast<size_t>(n));
+    }
+    memcpy(pptr(), s, n);
+    pbump(static_cast<int>(n));
+    return n;
+  }
+
+ private:
+  void Reset(size_t used) {
+    char* data = buffer_->data.get();
+    setp(data, data + buffer_->capacity - 1);
+    pbump(static_cast<int>(used));
+  }
+
+  void Grow(size_t extra) {
+    size_t used = pptr() - pbase();
+    size_t capacity = buffer_->capacity;
+    while (capacity - 1 - used < extra) capacity *= 2;
+    std::unique_ptr<char[]> data(new char[capacity]);
+    memcpy(data.get(), pbase(), used);
+    buffer_->data = std::move(data);
+    buffer_->capacity = capacity;
+    Reset(used);
+  }
+
+  LogBufferCache::Buffer* buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogStreamBuf);
+};
+
 // This indirection greatly reduces the stack impact of having lots of
 // checks/logging in a function.
 class LogMessageData {
  public:
   LogMessageData(const char* file, unsigned int line, LogSeverity severity, const char* tag,
                  int error)
-      : file_(GetFileBasename(file)),
+      : buffer_(&streambuf_),
+        file_(GetFileBasename(file)),
         line_number_(line),
         severity_(severity),
         tag_(tag),
         error_(error) {}
 
+  static void* operator new(size_t size) { return LogBufferCache::AcquireBlock(size); }
+  static void operator delete(void* p) { LogBufferCache::ReleaseBlock(p); }
+
   const char* GetFile() const {
     return file_;
   }
@@ -509,12 +1497,12 @@ class LogMessageData {
     return buffer_;
   }
 
-  std::string ToString() const {
-    return buffer_.str();
-  }
+  // Returns the message, which stays valid until this object is destroyed.
+  const char* c_str() { return streambuf_.c_str(); }
 
  private:
-  std::ostringstream buffer_;
+  LogStreamBuf streambuf_;
+  std::ostream buffer_;
   const char* const file_;
   const unsigned int line_number_;
   const LogSeverity severity_;
@@ -524,49 +1512,487 @@ class LogMessageData {
   DISALLOW_COPY_AND_ASSIGN(LogMessageData);
 };
 
-LogMessage::LogMessage(const char* file, unsigned int line, LogId, LogSeverity severity,
-                       const char* tag, int error)
-    : LogMessage(file, line, severity, tag, error) {}
+// Checked on every log message before touching anything else to do with statistics.
+static std::atomic<bool> gLogStatisticsEnabled{false};
 
-LogMessage::LogMessage(const char* file, unsigned int line, LogSeverity severity, const char* tag,
-                       int error)
-    : data_(new LogMessageData(file, line, severity, tag, error)) {}
+class LogStatisticsCollector {
+ public:
+  static LogStatisticsCollector& Get() {
+    static auto& collector = *new LogStatisticsCollector();
+    return collector;
+  }
 
-LogMessage::~LogMessage() {
-  // Check severity again. This is duplicate work wrt/ LOG macros, but not LOG_STREAM.
-  if (!WOULD_LOG(data_->GetSeverity())) {
-    return;
+  void RecordEmitted(LogSeverity severity, const char* tag, size_t bytes) {
+    severities_[severity].emitted.fetch_add(1, std::memory_order_relaxed);
+    severities_[severity].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    RcuReadLock lock;
+    Counters& tag_counters = ForTag(tag);
+    tag_counters.emitted.fetch_add(1, std::memory_order_relaxed);
+    tag_counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
   }
 
-  // Finish constructing the message.
-  if (data_->GetError() != -1) {
-    data_->GetBuffer() << ": " << strerror(data_->GetError());
+  void RecordSuppressed(LogSeverity severity, const char* tag) {
+    severities_[severity].suppressed.fetch_add(1, std::memory_order_relaxed);
+    RcuReadLock lock;
+    ForTag(tag).suppressed.fetch_add(1, std::memory_order_relaxed);
   }
-  std::string msg(data_->ToString());
 
-  if (data_->GetSeverity() == FATAL) {
+  void RecordLatency(LogSeverity severity, uint64_t ns) {
+    size_t bucket = 0;
+    while (ns > 1 && bucket < LogStatistics::kLatencyBuckets - 1) {
+      ns >>= 1;
+      ++bucket;
+    }
+    latency_[severity][bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  LogStatistics Read() {
+    LogStatistics statistics;
+    for (size_t i = 0; i <= FATAL; ++i) {
+      statistics.severities[i] = severities_[i].Load();
+      for (size_t j = 0; j < LogStatistics::kLatencyBuckets; ++j) {
+        statistics.latency[i][j] = latency_[i][j].load(std::memory_order_relaxed);
+      }
+    }
+    RcuReadLock lock;
+    tags_.Read()->Read(&statistics.tags);
+    return statistics;
+  }
+
+  void Reset() {
+    for (size_t i = 0; i <= FATAL; ++i) {
+      severities_[i].Reset();
+      for (auto& bucket : latency_[i]) bucket.store(0, std::memory_order_relaxed);
+    }
+    // Threads that are logging may still be counting into the old table, which is only freed once
+    // they're done with it.  Nobody reads it again, so what they count is just lost.
+    tags_.Replace(new TagTable());
+  }
+
+ private:
+  struct Counters {
+    std::atomic<uint64_t> emitted{0};
+    std::atomic<uint64_t> suppressed{0};
+    std::atomic<uint64_t> bytes{0};
+
+    LogStatistics::Counters Load() const {
+      LogStatistics::Counters counters;
+      counters.emitted = emitted.load(std::memory_order_relaxed);
+      counters.suppressed = suppressed.load(std::memory_order_relaxed);
+      counters.bytes = bytes.load(std::memory_order_relaxed);
+      return counters;
+    }
+
+    void Reset() {
+      emitted.store(0, std::memory_order_relaxed);
+      suppressed.store(0, std::memory_order_relaxed);
+      bytes.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  // The counters of up to kMaxTags tags, in an open-addressed table that's never more than half
+  // full.  Each slot is filled in once, under tags_lock_, and published by storing its name, so
+  // finding a tag that's already there takes no lock.  Slots are never reused: Reset() replaces
+  // the whole table.
+  class TagTable {
+   public:
+    TagTable() = default;
+
+    ~TagTable() {
+      for (Slot& slot : slots_) delete[] slot.name.load(std::memory_order_relaxed);
+    }
+
+    // Returns the counters for `name`, or null if it hasn't been added.
+    Counters* Find(std::string_view name, size_t hash) {
+      for (size_t i = hash;; ++i) {
+        Slot& slot = slots_[i & (kSlots - 1)];
+        const char* slot_name = slot.name.load(std::memory_order_acquire);
+        if (slot_name == nullptr) return nullptr;
+        if (slot.hash == hash && std::string_view(slot_name, slot.size) == name) {
+          return &slot.counters;
+        }
+      }
+    }
+
+    bool full() const { return size_.load(std::memory_order_relaxed) == LogStatistics::kMaxTags; }
+
+    // Counts the tags that didn't get counters of their own.
+    Counters& other() { return other_; }
+
+    // Must be called with tags_lock_ held.  Returns the counters for `name`, adding it if there's
+    // room.
+    Counters& Add(std::string_view name, size_t hash) {
+      if (Counters* counters = Find(name, hash)) return *counters;
+      if (full()) return other_;
+      size_t i = hash;
+      while (slots_[i & (kSlots - 1)].name.load(std::memory_order_relaxed) != nullptr) ++i;
+      Slot& slot = slots_[i & (kSlots - 1)];
+      char* slot_name = new char[name.size() + 1];
+      memcpy(slot_name, name.data(), name.size());
+      slot_name[name.size()] = '\0';
+      slot.size = name.size();
+      slot.hash = hash;
+      slot.name.store(slot_name, std::memory_order_release);
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return slot.counters;
+    }
+
+    void Read(std::map<std::string, LogStatistics::Counters>* tags) {
+      for (Slot& slot : slots_) {
+        const char* slot_name = slot.name.load(std::memory_order_acquire);
+        if (slot_name != nullptr) {
+          tags->emplace(std::string(slot_name, slot.size), slot.counters.Load());
+        }
+      }
+      LogStatistics::Counters other = other_.Load();
+      if (other.emitted != 0 || other.suppressed != 0) {
+        LogStatistics::Counters& counters = (*tags)["(other)"];
+        counters.emitted += other.emitted;
+        counters.suppressed += other.suppressed;
+        counters.bytes += other.bytes;
+      }
+    }
+
+   private:
+    static constexpr size_t kSlots = 2 * LogStatistics::kMaxTags;
+    static_assert((kSlots & (kSlots - 1)) == 0, "kSlots must be a power of two");
+
+    struct Slot {
+      // Null until the slot is filled in, after which the other fields don't change.
+      std::atomic<const char*> name{nullptr};
+      size_t size = 0;
+      size_t hash = 0;
+      Counters counters;
+    };
+
+    Slot slots_[kSlots];
+    std::atomic<size_t> size_{0};
+    Counters other_;
+
+    DISALLOW_COPY_AND_ASSIGN(TagTable);
+  };
+
+  LogStatisticsCollector() = default;
+
+  // Must be called with an RcuReadLock held, for as long as the counters are used.
+  Counters& ForTag(const char* tag) {
+    std::string_view name = tag != nullptr ? tag : "";
+    size_t hash = std::hash<std::string_view>()(name);
+    TagTable* table = tags_.Read();
+    if (Counters* counters = table->Find(name, hash)) return *counters;
+    if (table->full()) return table->other();
+    // If Reset() has replaced the table in the meantime, this adds to the old one, which is fine:
+    // it's as if the message had been counted before the reset.
+    std::lock_guard<std::mutex> lock(tags_lock_);
+    return table->Add(name, hash);
+  }
+
+  Counters severities_[FATAL + 1];
+  std::atomic<uint64_t> latency_[FATAL + 1][LogStatistics::kLatencyBuckets] = {};
+  // Serializes adding tags.
+  std::mutex tags_lock_;
+  RcuPointer<TagTable> tags_{new TagTable()};
+
+  DISALLOW_COPY_AND_ASSIGN(LogStatisticsCollector);
+};
+
+// Records how long the enclosing scope takes in the latency histogram, if statistics are enabled.
+class ScopedLogLatency {
+ public:
+  explicit ScopedLogLatency(LogSeverity severity)
+      : severity_(severity), enabled_(gLogStatisticsEnabled.load(std::memory_order_relaxed)) {
+    if (UNLIKELY(enabled_)) start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedLogLatency() {
+    if (LIKELY(!enabled_)) return;
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    LogStatisticsCollector::Get().RecordLatency(
+        severity_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+ private:
+  const LogSeverity severity_;
+  const bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLogLatency);
+};
+
+void SetLogStatisticsEnabled(bool enabled) {
+  // Create the collector before anything can try to record into it.
+  LogStatisticsCollector::Get();
+  gLogStatisticsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+LogStatistics GetLogStatistics() {
+  return LogStatisticsCollector::Get().Read();
+}
+
+void ResetLogStatistics() {
+  LogStatisticsCollector::Get().Reset();
+}
+
+// Returns an upper bound for the given percentile of a latency histogram, or 0 if it's empty.
+static uint64_t LatencyPercentile(const uint64_t (&histogram)[LogStatistics::kLatencyBuckets],
+                                  double percentile) {
+  uint64_t total = 0;
+  for (uint64_t count : histogram) total += count;
+  if (total == 0) return 0;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < LogStatistics::kLatencyBuckets; ++i) {
+    seen += histogram[i];
+    if (seen >= total * percentile) return (uint64_t{2} << i) - 1;
+  }
+  return std::numeric_limits<uint64_t>::max();
+}
+
+std::string FormatLogStatistics(const LogStatistics& statistics) {
+  static constexpr const char* kSeverityNames[] = {
+      "VERBOSE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL_WITHOUT_ABORT", "FATAL",
+  };
+  static_assert(arraysize(kSeverityNames) == FATAL + 1,
+                "Mismatch in size of kSeverityNames and values in LogSeverity");
+
+  std::string result = StringPrintf("%-20s %10s %10s %12s %10s %10s\n", "severity", "emitted",
+                                    "suppressed", "bytes", "p50 ns", "p99 ns");
+  for (size_t i = 0; i <= FATAL; ++i) {
+    const LogStatistics::Counters& counters = statistics.severities[i];
+    result += StringPrintf("%-20s %10" PRIu64 " %10" PRIu64 " %12" PRIu64 " %10" PRIu64
+                           " %10" PRIu64 "\n",
+                           kSeverityNames[i], counters.emitted, counters.suppressed,
+                           counters.bytes, LatencyPercentile(statistics.latency[i], 0.5),
+                           LatencyPercentile(statistics.latency[i], 0.99));
+  }
+
+  std::vector<std::pair<std::string, LogStatistics::Counters>> tags(statistics.tags.begin(),
+                                                                    statistics.tags.end());
+  std::stable_sort(tags.begin(), tags.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second.bytes > rhs.second.bytes;
+  });
+  result += StringPrintf("%-20s %10s %10s %12s\n", "tag", "emitted", "suppressed", "bytes");
+  for (const auto& [tag, counters] : tags) {
+    result += StringPrintf("%-20s %10" PRIu64 " %10" PRIu64 " %12" PRIu64 "\n",
+                           tag.empty() ? "(default)" : tag.c_str(), counters.emitted,
+                           counters.suppressed, counters.bytes);
+  }
+  return result;
+}
+
+void SetLogStatisticsDumpInterval(std::chrono::milliseconds interval,
+                                  std::function<void(const LogStatistics& statistics)> dump) {
+  struct Dumper {
+    // Serializes calls to SetLogStatisticsDumpInterval.
+    std::mutex control_lock;
+    std::mutex lock;
+    std::condition_variable cv;
+    // Guarded by lock.
+    bool stopping = false;
+    // Guarded by control_lock.
+    std::thread thread;
+  };
+  static auto& dumper = *new Dumper();
+
+  std::lock_guard<std::mutex> control_lock(dumper.control_lock);
+  if (dumper.thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(dumper.lock);
+      dumper.stopping = true;
+    }
+    dumper.cv.notify_all();
+    dumper.thread.join();
+    dumper.stopping = false;
+  }
+  if (interval <= std::chrono::milliseconds::zero()) return;
+
+  dumper.thread = std::thread([interval, dump = std::move(dump)]() {
+    std::unique_lock<std::mutex> lock(dumper.lock);
+    while (!dumper.cv.wait_for(lock, interval, [] { return dumper.stopping; })) {
+      lock.unlock();
+      LogStatistics statistics = GetLogStatistics();
+      if (dump) {
+        dump(statistics);
+      } else {
+        LOG(INFO) << "log statistics:\n" << FormatLogStatistics(statistics);
+      }
+      lock.lock();
+    }
+  });
+}
+
+// Logs a finished message, and aborts if it's FATAL.
+static void LogAndMaybeAbort(const char* file, unsigned int line, LogSeverity severity,
+                             const char* tag, const char* msg) {
+  // Don't let an abort lose LOGB messages that are still waiting to be formatted.
+  if (severity >= FATAL_WITHOUT_ABORT) {
+    FlushBinaryLogs();
+  }
+
+  if (severity == FATAL) {
 #ifdef __ANDROID__
     // Set the bionic abort message early to avoid liblog doing it
     // with the individual lines, so that we get the whole message.
-    android_set_abort_message(msg.c_str());
+    android_set_abort_message(msg);
 #endif
   }
 
-  LogLine(data_->GetFile(), data_->GetLineNumber(), data_->GetSeverity(), data_->GetTag(),
-          msg.c_str());
+  LogMessage::LogLine(file, line, severity, tag, msg);
 
   // Abort if necessary.
-  if (data_->GetSeverity() == FATAL) {
+  if (severity == FATAL) {
 #ifndef _MSC_VER
     if (__builtin_available(android 30, *))
     {
-      __android_log_call_aborter(msg.c_str());
+      __android_log_call_aborter(msg);
     } else 
 #endif
     {
-      Aborter()(msg.c_str());
+      CallAborter(msg);
+    }
+  }
+}
+
+// The buffer that LOGF formats into.  Each thread has one, reused from message to message; a
+// message logged while the thread's buffer is busy (by a formatter, or by the logger itself) or
+// while the thread is exiting gets a buffer of its own.
+class ScopedLogFormatBuffer {
+ public:
+  ScopedLogFormatBuffer() {
+    State* state = Get();
+    if (state != nullptr && !state->in_use) {
+      state->in_use = true;
+      state_ = state;
+      buffer_ = &state->buffer;
+    } else {
+      buffer_ = &local_buffer_;
+    }
+  }
+
+  ~ScopedLogFormatBuffer() {
+    if (state_ == nullptr) return;
+    // Don't let one huge message pin its buffer for the rest of the thread's life.
+    if (state_->buffer.capacity() > kMaxBufferSize) {
+      state_->buffer = fmt::memory_buffer();
     }
+    state_->buffer.clear();
+    state_->in_use = false;
+  }
+
+  fmt::memory_buffer& get() { return *buffer_; }
+
+ private:
+  static constexpr size_t kMaxBufferSize = 64 * 1024;
+
+  struct State {
+    ~State() { destroyed = true; }
+
+    fmt::memory_buffer buffer;
+    bool in_use = false;
+  };
+
+  static State* Get() {
+    if (destroyed) return nullptr;
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+    static thread_local State state;
+#pragma clang diagnostic pop
+    return &state;
+  }
+
+  static thread_local bool destroyed;
+
+  State* state_ = nullptr;
+  fmt::memory_buffer* buffer_;
+  fmt::memory_buffer local_buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLogFormatBuffer);
+};
+
+thread_local bool ScopedLogFormatBuffer::destroyed = false;
+
+namespace log_detail {
+
+void LogFormatted(const char* file, unsigned int line, LogSeverity severity, const char* tag,
+                  int error, std::string_view prefix, fmt::string_view format,
+                  fmt::format_args args) {
+  ScopedLogLatency latency(severity);
+  ScopedLogFormatBuffer scoped_buffer;
+  fmt::memory_buffer& buffer = scoped_buffer.get();
+  buffer.append(prefix.data(), prefix.data() + prefix.size());
+  fmt::vformat_to(std::back_inserter(buffer), format, args);
+  if (error != -1) {
+    fmt::format_to(std::back_inserter(buffer), ": {}", strerror(error));
+  }
+  buffer.push_back('\0');
+  LogAndMaybeAbort(GetFileBasename(file), line, severity, tag, buffer.data());
+}
+
+}  // namespace log_detail
+
+// Decides whether to log given the tag's minimum severity (-1 if it has none), which the callers
+// find in their own ways.
+static bool ShouldLogUncounted(LogSeverity severity, const char* tag, int tag_severity) {
+  if (tag_severity != -1) {
+    return severity >= tag_severity;
+  }
+
+  // Even though we're not using the R liblog functions in this function, if we're running on Q,
+  // we need to fall back to using gMinimumLogSeverity, since __android_log_is_loggable() will not
+  // take into consideration the value from SetMinimumLogSeverity().
+#ifndef _MSC_VER
+  if (__builtin_available(android 30, *)) {
+    int32_t priority = LogSeverityToPriority(severity);
+    return __android_log_is_loggable(priority, tag, ANDROID_LOG_INFO);
+  } else
+#endif
+  {
+    return severity >= gMinimumLogSeverity.load(std::memory_order_relaxed);
+  }
+}
+
+static bool ShouldLogWithTagSeverity(LogSeverity severity, const char* tag, int tag_severity) {
+  bool should_log = ShouldLogUncounted(severity, tag, tag_severity);
+  if (UNLIKELY(!should_log && gLogStatisticsEnabled.load(std::memory_order_relaxed))) {
+    LogStatisticsCollector::Get().RecordSuppressed(severity, tag);
+  }
+  return should_log;
+}
+
+bool ShouldLog(LogSeverity severity, const char* tag) {
+  return ShouldLogWithTagSeverity(severity, tag, FindTagSeverity(tag));
+}
+
+LogMessage::LogMessage(const char* file, unsigned int line, LogId, LogSeverity severity,
+                       const char* tag, int error)
+    : LogMessage(file, line, severity, tag, error) {}
+
+LogMessage::LogMessage(const char* file, unsigned int line, LogSeverity severity, const char* tag,
+                       int error)
+    : data_(new LogMessageData(file, line, severity, tag, error)) {}
+
+LogMessage::~LogMessage() {
+  // Check severity again. This is duplicate work wrt/ LOG macros, but not LOG_STREAM. It has to
+  // use the message's own tag: WOULD_LOG here would only see this file's LOG_TAG, which is none.
+  // The tag's minimum severity is usually what the LOG macro's call site just found. FATAL
+  // messages are always logged, since they abort.
+  if (data_->GetSeverity() != FATAL) {
+    const char* tag = data_->GetTag();
+    const CallSiteTagSeverity& last = gLastCallSiteTagSeverity;
+    int tag_severity =
+        last.tag == tag && last.generation == gTagSeverityGeneration.load(std::memory_order_acquire)
+            ? last.severity
+            : FindTagSeverity(tag);
+    if (!ShouldLogWithTagSeverity(data_->GetSeverity(), tag, tag_severity)) return;
+  }
+
+  ScopedLogLatency latency(data_->GetSeverity());
+
+  // Finish constructing the message.
+  if (data_->GetError() != -1) {
+    data_->GetBuffer() << ": " << strerror(data_->GetError());
   }
+  LogAndMaybeAbort(data_->GetFile(), data_->GetLineNumber(), data_->GetSeverity(),
+                   data_->GetTag(), data_->c_str());
 }
 
 std::ostream& LogMessage::stream() {
@@ -575,6 +2001,10 @@ std::ostream& LogMessage::stream() {
 
 void LogMessage::LogLine(const char* file, unsigned int line, LogSeverity severity, const char* tag,
                          const char* message) {
+  if (UNLIKELY(gLogStatisticsEnabled.load(std::memory_order_relaxed))) {
+    LogStatisticsCollector::Get().RecordEmitted(severity, tag, strlen(message));
+  }
+
 #ifdef _MSC_VER
     __android_log_print_ext(LogSeverityToAndroid_LogPriority(severity), tag, file, line, "%s", message);
 #else
@@ -585,16 +2015,12 @@ void LogMessage::LogLine(const char* file, unsigned int line, LogSeverity severi
     __android_log_write_log_message(&log_message);
   } else
   {
+    RcuReadLock lock;
     if (tag == nullptr) {
-      std::lock_guard<std::recursive_mutex> lock(TagLock());
-      if (gDefaultTag == nullptr) {
-        gDefaultTag = new std::string(getprogname());
-      }
-
-      Logger()(DEFAULT, severity, gDefaultTag->c_str(), file, line, message);
-    } else {
-      Logger()(DEFAULT, severity, tag, file, line, message);
+      InternedString default_tag = gDefaultTag.load(std::memory_order_acquire);
+      tag = !default_tag.empty() ? default_tag.c_str() : getprogname();
     }
+    (*Logger().Read())(DEFAULT, severity, tag, file, line, message);
   }
 #endif
 }
@@ -606,22 +2032,7 @@ LogSeverity GetMinimumLogSeverity() {
   } else
 #endif
   {
-    return gMinimumLogSeverity;
-  }
-}
-
-bool ShouldLog(LogSeverity severity, const char* tag) {
-  // Even though we're not using the R liblog functions in this function, if we're running on Q,
-  // we need to fall back to using gMinimumLogSeverity, since __android_log_is_loggable() will not
-  // take into consideration the value from SetMinimumLogSeverity().
-#ifndef _MSC_VER
-  if (__builtin_available(android 30, *)) {
-    int32_t priority = LogSeverityToPriority(severity);
-    return __android_log_is_loggable(priority, tag, ANDROID_LOG_INFO);
-  } else
-#endif
-  {
-    return severity >= gMinimumLogSeverity;
+    return gMinimumLogSeverity.load(std::memory_order_relaxed);
   }
 }
 
@@ -633,9 +2044,7 @@ LogSeverity SetMinimumLogSeverity(LogSeverity new_severity) {
   } else
 #endif
   {
-    LogSeverity old_severity = gMinimumLogSeverity;
-    gMinimumLogSeverity = new_severity;
-    return old_severity;
+    return gMinimumLogSeverity.exchange(new_severity, std::memory_order_relaxed);
   }
 }
 
@@ -647,5 +2056,91 @@ ScopedLogSeverity::~ScopedLogSeverity() {
   SetMinimumLogSeverity(old_);
 }
 
+namespace log_detail {
+
+static thread_local uint64_t gLogSuppressedCount = 0;
+
+void SetLogSuppressedCount(uint64_t count) {
+  gLogSuppressedCount = count;
+}
+
+std::ostream& operator<<(std::ostream& os, LogSuppressedCount) {
+  if (gLogSuppressedCount != 0) {
+    os << "(" << gLogSuppressedCount << " suppressed) ";
+    gLogSuppressedCount = 0;
+  }
+  return os;
+}
+
+bool TagSeverityCache::ShouldLog(LogSeverity severity, const char* tag) {
+  // If the table changes after the generation is read, the lookup may see the new table, and the
+  // value is cached for the old generation; the next call just looks it up again.
+  uint64_t generation = gTagSeverityGeneration.load(std::memory_order_acquire);
+  uint32_t sequence = sequence_.load(std::memory_order_acquire);
+  const char* cached_tag = tag_.load(std::memory_order_relaxed);
+  uint64_t cached = cached_.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  int tag_severity;
+  if (LIKELY(cached_tag == tag && cached >> 8 == generation && sequence % 2 == 0 &&
+             sequence_.load(std::memory_order_relaxed) == sequence)) {
+    tag_severity = static_cast<int>(cached & 0xff) - 1;
+  } else {
+    tag_severity = FindTagSeverity(tag);
+    // If another thread is already updating the cache, it's left to that thread.
+    if (sequence % 2 == 0 &&
+        sequence_.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed)) {
+      std::atomic_thread_fence(std::memory_order_release);
+      tag_.store(tag, std::memory_order_relaxed);
+      cached_.store(generation << 8 | static_cast<uint64_t>(tag_severity + 1),
+                    std::memory_order_relaxed);
+      sequence_.store(sequence + 2, std::memory_order_release);
+    }
+  }
+
+  if (!ShouldLogWithTagSeverity(severity, tag, tag_severity)) return false;
+  gLastCallSiteTagSeverity = {tag, generation, tag_severity};
+  return true;
+}
+
+bool LogEveryTState::ShouldLog(std::chrono::nanoseconds period) {
+  int64_t now = boot_clock::now().time_since_epoch().count();
+  int64_t next = next_.load(std::memory_order_relaxed);
+  // If several threads get here at once, only the one that moves next_ on gets to log.
+  if (now < next || !next_.compare_exchange_strong(next, now + period.count(),
+                                                   std::memory_order_relaxed)) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  SetLogSuppressedCount(suppressed_.exchange(0, std::memory_order_relaxed));
+  return true;
+}
+
+// A per-thread xorshift64* generator: sampling needn't be high quality, just cheap and free of
+// contention.
+static uint64_t NextRandom() {
+  static thread_local uint64_t state = 0;
+  if (state == 0) {
+    state = static_cast<uint64_t>(boot_clock::now().time_since_epoch().count()) ^
+            reinterpret_cast<uintptr_t>(&state) ^ 0x9e3779b97f4a7c15u;
+    if (state == 0) state = 1;
+  }
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1du;
+}
+
+bool LogSampledState::ShouldLog(double probability) {
+  // Compare the top 53 bits of a random number, as a double in [0, 1), with the probability.
+  if (static_cast<double>(NextRandom() >> 11) * 0x1.0p-53 >= probability) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  SetLogSuppressedCount(suppressed_.exchange(0, std::memory_order_relaxed));
+  return true;
+}
+
+}  // namespace log_detail
+
 }  // namespace base
 }  // namespace android
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/binary_logging.h"
+#include "android-base/logging.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "allocation_count.h"
+#include "android-base/threads.h"
+#include "logging_splitters.h"
+
+static void NullLogger(android::base::LogId, android::base::LogSeverity, const char*, const char*,
+                       unsigned int, const char* message) {
+  benchmark::DoNotOptimize(message);
+}
+
+class AllocationCounter {
+ public:
+  explicit AllocationCounter(benchmark::State& state)
+      : state_(state), start_(AllocationCount()) {}
+
+  ~AllocationCounter() {
+    state_.counters["allocs/op"] =
+        benchmark::Counter(AllocationCount() - start_,
+                           benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State& state_;
+  size_t start_;
+};
+
+// LOG(INFO) through LogMessage, with the message discarded by the logger.
+static void BenchmarkLogMessage(benchmark::State& state) {
+  auto old_logger = android::base::SetLogger(NullLogger);
+  {
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+      LOG(INFO) << "hello " << 42 << " world " << 1.5;
+    }
+  }
+  android::base::SetLogger(std::move(old_logger));
+}
+BENCHMARK(BenchmarkLogMessage);
+
+// The work LogMessage used to do for each message: a heap-allocated ostringstream, plus a copy of
+// its contents to hand to the logger.
+static void BenchmarkOstringstreamMessage(benchmark::State& state) {
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto stream = std::make_unique<std::ostringstream>();
+    *stream << "hello " << 42 << " world " << 1.5;
+    std::string message(stream->str());
+    NullLogger(android::base::DEFAULT, android::base::INFO, nullptr, __FILE__, __LINE__,
+               message.c_str());
+  }
+}
+BENCHMARK(BenchmarkOstringstreamMessage);
+
+// LOGB(INFO): the caller only encodes the arguments; a background thread formats the message.
+static void BenchmarkLogBinary(benchmark::State& state) {
+  auto old_logger = android::base::SetLogger(NullLogger);
+  {
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+      LOGB(INFO, "hello {} world {}", 42, 1.5);
+    }
+    android::base::FlushBinaryLogs();
+  }
+  android::base::SetLogger(std::move(old_logger));
+}
+BENCHMARK(BenchmarkLogBinary);
+
+// Points stderr at /dev/null for the life of the object.
+class ScopedStderrToDevNull {
+ public:
+  ScopedStderrToDevNull() : saved_fd_(dup(STDERR_FILENO)) {
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+  }
+  ~ScopedStderrToDevNull() {
+    dup2(saved_fd_, STDERR_FILENO);
+    close(saved_fd_);
+  }
+
+ private:
+  int saved_fd_;
+};
+
+static std::string MultiLineMessage(int lines) {
+  std::string message;
+  for (int i = 0; i < lines; ++i) {
+    if (i != 0) message += '\n';
+    message += "  #" + std::to_string(i) + " pc 000000000004a1c4  /system/lib64/libfoo.so (Foo+20)";
+  }
+  return message;
+}
+
+// StderrLogger, which writes each message with writev() straight from the message.
+static void BenchmarkStderrLogger(benchmark::State& state) {
+  std::string message = MultiLineMessage(state.range(0));
+  ScopedStderrToDevNull redirect;
+  for (auto _ : state) {
+    android::base::StderrLogger(android::base::DEFAULT, android::base::INFO, "tag", nullptr, 0,
+                                message.c_str());
+  }
+}
+BENCHMARK(BenchmarkStderrLogger)->Arg(1)->Arg(20)->Arg(200);
+
+// What StderrLogger used to do: build the whole output in a string, and fputs() it.
+static void BenchmarkStderrOutputGenerator(benchmark::State& state) {
+  std::string message = MultiLineMessage(state.range(0));
+  ScopedStderrToDevNull redirect;
+  for (auto _ : state) {
+    struct tm now;
+    time_t t = time(nullptr);
+    localtime_r(&t, &now);
+    std::string output = android::base::StderrOutputGenerator(
+        now, getpid(), android::base::GetThreadId(), android::base::INFO, "tag", nullptr, 0,
+        message.c_str());
+    fputs(output.c_str(), stderr);
+  }
+}
+BENCHMARK(BenchmarkStderrOutputGenerator)->Arg(1)->Arg(20)->Arg(200);
+
+// Writes to a non-blocking pipe standing in for /dev/kmsg, draining it after every message.
+class KmsgPipe {
+ public:
+  KmsgPipe() {
+    if (pipe2(fds_, O_CLOEXEC | O_NONBLOCK) == -1) abort();
+  }
+  ~KmsgPipe() {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  int write_fd() const { return fds_[1]; }
+
+  void Drain() {
+    char buf[4096];
+    while (read(fds_[0], buf, sizeof(buf)) > 0) {
+    }
+  }
+
+ private:
+  int fds_[2];
+};
+
+// KernelLogger's writes: one writev() per line, straight from the message.
+static void BenchmarkKernelLogRecords(benchmark::State& state) {
+  std::string message = MultiLineMessage(state.range(0));
+  KmsgPipe kmsg;
+  auto write_record = [&](struct iovec* iov, int count) { writev(kmsg.write_fd(), iov, count); };
+  for (auto _ : state) {
+    android::base::KernelLogRecords(6, "tag", {}, message.c_str(), write_record);
+    kmsg.Drain();
+  }
+}
+BENCHMARK(BenchmarkKernelLogRecords)->Arg(1)->Arg(20)->Arg(200);
+
+// What KernelLogger used to do: snprintf() each line into a buffer, and write() it.
+static void BenchmarkKernelLogSnprintf(benchmark::State& state) {
+  std::string message = MultiLineMessage(state.range(0));
+  KmsgPipe kmsg;
+  auto write_line = [&](const char* msg, int length) {
+    char buf[android::base::kKernelLogLineMax];
+    size_t size = snprintf(buf, sizeof(buf), "<%d>%s: %.*s\n", 6, "tag", length, msg);
+    write(kmsg.write_fd(), buf, std::min(size, sizeof(buf)));
+  };
+  for (auto _ : state) {
+    android::base::SplitByLines(message.c_str(), write_line);
+    kmsg.Drain();
+  }
+}
+BENCHMARK(BenchmarkKernelLogSnprintf)->Arg(1)->Arg(20)->Arg(200);
+
+// Splitting a FATAL stack trace into logd-sized chunks, each prefixed with the file and line.
+static void BenchmarkSplitByLogdChunks(benchmark::State& state) {
+  std::string message = MultiLineMessage(state.range(0));
+  size_t total = 0;
+  auto log_function = [&](android::base::LogId, android::base::LogSeverity, const char*,
+                          const char* chunk, size_t size) {
+    benchmark::DoNotOptimize(chunk);
+    total += size;
+  };
+  for (auto _ : state) {
+    android::base::SplitByLogdChunks(android::base::MAIN, android::base::FATAL, "tag",
+                                     "system/core/libfoo/foo.cpp", 123, {}, message.c_str(),
+                                     message.size(), log_function);
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+  benchmark::DoNotOptimize(total);
+}
+BENCHMARK(BenchmarkSplitByLogdChunks)->Arg(1)->Arg(20)->Arg(64)->Arg(200);
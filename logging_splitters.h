@@ -17,12 +17,22 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if !defined(_WIN32)
+#include <sys/uio.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <android-base/logging.h>
+#include <android-base/macros.h>
 #include <android-base/stringprintf.h>
 
-#include <vector>
-
 #define LOGGER_ENTRY_MAX_PAYLOAD 4068  // This constant is not in the NDK.
 
 namespace android {
@@ -43,12 +53,16 @@ static void SplitByLines(const char* msg, const F& log_function, Args&&... args)
 }
 
 // This splits the message up into chunks that logs can process delimited by new lines.  It calls
-// log_function with the exact null terminated message that should be sent to logd.
-// Note, despite the loops and snprintf's, if severity is not fatal and there are no new lines,
-// this function simply calls log_function with msg without any extra overhead.
+// log_function(log_id, severity, tag, chunk, chunk_size) with the exact message that should be
+// sent to logd; chunk[chunk_size] is always '\0', so msg itself must be null terminated at
+// msg[length].  The message is scanned once, and lines are copied into the chunk with memcpy.
+// Each line starts with the context in brackets (see GetLogContext()) if it isn't empty.
+// Note, if severity is not fatal, the context is empty and there are no new lines, this function
+// simply calls log_function with msg without any extra overhead.
 template <typename F>
 static void SplitByLogdChunks(LogId log_id, LogSeverity severity, const char* tag, const char* file,
-                              unsigned int line, const char* msg, const F& log_function) {
+                              unsigned int line, std::string_view context, const char* msg,
+                              size_t length, const F& log_function) {
   // The maximum size of a payload, after the log header that logd will accept is
   // LOGGER_ENTRY_MAX_PAYLOAD, so subtract the other elements in the payload to find the size of
   // the string that we can log in each pass.
@@ -56,69 +70,68 @@ static void SplitByLogdChunks(LogId log_id, LogSeverity severity, const char* ta
   // Specifically we subtract a byte for the priority, the length of the tag + its null terminator,
   // and an additional byte for the null terminator on the payload.  We subtract an additional 32
   // bytes for slack, similar to java/android/util/Log.java.
-  ptrdiff_t max_size = LOGGER_ENTRY_MAX_PAYLOAD - strlen(tag) - 35;
-  if (max_size <= 0) {
+  ptrdiff_t signed_max_size = LOGGER_ENTRY_MAX_PAYLOAD - strlen(tag) - 35;
+  if (signed_max_size <= 0) {
     abort();
   }
+  size_t max_size = signed_max_size;
+
   // If we're logging a fatal message, we'll append the file and line numbers.
   bool add_file = file != nullptr && (severity == FATAL || severity == FATAL_WITHOUT_ABORT);
 
   std::string file_header;
+  if (!context.empty()) {
+    file_header.append("[").append(context).append("] ");
+  }
   if (add_file) {
-    file_header = StringPrintf("%s:%u] ", file, line);
+    file_header += StringPrintf("%s:%u] ", file, line);
   }
-  int file_header_size = file_header.size();
+  size_t file_header_size = file_header.size();
 
-  /*__attribute__((uninitialized)) char logd_chunk[max_size + 1];*/
-  std::vector<char> buffer;
-  buffer.resize( max_size + 1 );
-  char* logd_chunk = buffer.data();
-  ptrdiff_t chunk_position = 0;
+  char logd_chunk[LOGGER_ENTRY_MAX_PAYLOAD];
+  size_t chunk_position = 0;
 
   auto call_log_function = [&]() {
-    log_function(log_id, severity, tag, logd_chunk);
+    logd_chunk[chunk_position] = '\0';
+    log_function(log_id, severity, tag, logd_chunk, chunk_position);
     chunk_position = 0;
   };
 
-  auto write_to_logd_chunk = [&](const char* message, int length) {
-    int size_written = 0;
-    const char* new_line = chunk_position > 0 ? "\n" : "";
-    if (add_file) {
-      size_written = snprintf(logd_chunk + chunk_position, sizeof(logd_chunk) - chunk_position,
-                              "%s%s%.*s", new_line, file_header.c_str(), length, message);
-    } else {
-      size_written = snprintf(logd_chunk + chunk_position, sizeof(logd_chunk) - chunk_position,
-                              "%s%.*s", new_line, length, message);
-    }
+  // Appends as much of data as fits, silently truncating the rest.
+  auto append = [&](const char* data, size_t size) {
+    size_t copied = std::min(size, max_size - chunk_position);
+    memcpy(logd_chunk + chunk_position, data, copied);
+    chunk_position += copied;
+  };
 
-    // This should never fail, if it does and we set size_written to 0, which will skip this line
-    // and move to the next one.
-    if (size_written < 0) {
-      size_written = 0;
-    }
-    chunk_position += size_written;
+  auto write_to_logd_chunk = [&](const char* message, size_t size) {
+    if (chunk_position > 0) append("\n", 1);
+    append(file_header.data(), file_header_size);
+    append(message, size);
   };
 
-  const char* newline = strchr(msg, '\n');
+  const char* end = msg + length;
+  const char* newline = static_cast<const char*>(memchr(msg, '\n', end - msg));
   while (newline != nullptr) {
+    size_t size = newline - msg;
     // If we have data in the buffer and this next line doesn't fit, write the buffer.
-    if (chunk_position != 0 && chunk_position + (newline - msg) + 1 + file_header_size > max_size) {
+    if (chunk_position != 0 && chunk_position + size + 1 + file_header_size > max_size) {
       call_log_function();
     }
 
     // Otherwise, either the next line fits or we have any empty buffer and too large of a line to
     // ever fit, in both cases, we add it to the buffer and continue.
-    write_to_logd_chunk(msg, newline - msg);
+    write_to_logd_chunk(msg, size);
 
     msg = newline + 1;
-    newline = strchr(msg, '\n');
+    newline = static_cast<const char*>(memchr(msg, '\n', end - msg));
   }
 
   // If we have left over data in the buffer and we can fit the rest of msg, add it to the buffer
   // then write the buffer.
-  if (chunk_position != 0 &&
-      chunk_position + static_cast<int>(strlen(msg)) + 1 + file_header_size <= max_size) {
-    write_to_logd_chunk(msg, -1);
+  size_t rest = end - msg;
+  if (chunk_position != 0 && chunk_position + rest + 1 + file_header_size <= max_size) {
+    write_to_logd_chunk(msg, rest);
     call_log_function();
   } else {
     // If the buffer is not empty and we can't fit the rest of msg into it, write its contents.
@@ -126,15 +139,22 @@ static void SplitByLogdChunks(LogId log_id, LogSeverity severity, const char* ta
       call_log_function();
     }
     // Then write the rest of the msg.
-    if (add_file) {
-      snprintf(logd_chunk, sizeof(logd_chunk), "%s%s", file_header.c_str(), msg);
-      log_function(log_id, severity, tag, logd_chunk);
+    if (file_header_size != 0) {
+      write_to_logd_chunk(msg, rest);
+      call_log_function();
     } else {
-      log_function(log_id, severity, tag, msg);
+      log_function(log_id, severity, tag, msg, rest);
     }
   }
 }
 
+template <typename F>
+static void SplitByLogdChunks(LogId log_id, LogSeverity severity, const char* tag, const char* file,
+                              unsigned int line, const char* msg, const F& log_function) {
+  SplitByLogdChunks(log_id, severity, tag, file, line, std::string_view(), msg, strlen(msg),
+                    log_function);
+}
+
 static std::pair<int, int> CountSizeAndNewLines(const char* message) {
   int size = 0;
   int new_lines = 0;
@@ -148,33 +168,95 @@ static std::pair<int, int> CountSizeAndNewLines(const char* message) {
   return {size, new_lines};
 }
 
-// This adds the log header to each line of message and returns it as a string intended to be
-// written to stderr.
-static std::string StderrOutputGenerator(const struct tm& now, int pid, uint64_t tid,
-                                         LogSeverity severity, const char* tag, const char* file,
-                                         unsigned int line, const char* message) {
-  char timestamp[32];
-  strftime(timestamp, sizeof(timestamp), "%m-%d %H:%M:%S", &now);
-
-  static const char log_characters[] = "VDIWEFF";
-  static_assert(arraysize(log_characters) - 1 == FATAL + 1,
-                "Mismatch in size of log_characters and values in LogSeverity");
-  char severity_char = log_characters[severity];
-  std::string line_prefix;
-  if (file != nullptr) {
-    line_prefix = StringPrintf("%s %c %s %5d %5" PRIu64 " %s:%u] ", tag ? tag : "nullptr",
-                               severity_char, timestamp, pid, tid, file, line);
-  } else {
-    line_prefix = StringPrintf("%s %c %s %5d %5" PRIu64 " ", tag ? tag : "nullptr", severity_char,
-                               timestamp, pid, tid);
+// A message's context (see GetLogContext()) as "[context] ", or nothing if it has none, in the
+// pieces of a "%s%.*s%s" format.
+struct LogContextBrackets {
+  explicit LogContextBrackets(std::string_view context)
+      : open(context.empty() ? "" : "["),
+        size(static_cast<int>(context.size())),
+        data(context.empty() ? "" : context.data()),
+        close(context.empty() ? "" : "] ") {}
+
+  const char* open;
+  int size;
+  const char* data;
+  const char* close;
+};
+
+// The log header that StderrOutputGenerator adds to each line of a message, rendered once per
+// message into a stack buffer (or onto the heap, for an unusually long tag or file name).  A
+// non-empty `context` (see GetLogContext()) is shown in brackets ahead of the file name.
+class StderrLinePrefix {
+ public:
+  StderrLinePrefix(const struct tm& now, int pid, uint64_t tid, LogSeverity severity,
+                   const char* tag, const char* file, unsigned int line,
+                   std::string_view context = {}) {
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%m-%d %H:%M:%S", &now);
+    Init(timestamp, pid, tid, severity, tag, file, line, context);
   }
 
+  // As above, but with an already formatted timestamp.
+  StderrLinePrefix(const char* timestamp, int pid, uint64_t tid, LogSeverity severity,
+                   const char* tag, const char* file, unsigned int line,
+                   std::string_view context = {}) {
+    Init(timestamp, pid, tid, severity, tag, file, line, context);
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  void Init(const char* timestamp, int pid, uint64_t tid, LogSeverity severity, const char* tag,
+            const char* file, unsigned int line, std::string_view context) {
+    static const char log_characters[] = "VDIWEFF";
+    static_assert(arraysize(log_characters) - 1 == FATAL + 1,
+                  "Mismatch in size of log_characters and values in LogSeverity");
+    char severity_char = log_characters[severity];
+    if (tag == nullptr) tag = "nullptr";
+
+    LogContextBrackets brackets(context);
+
+    auto render = [&](char* buffer, size_t buffer_size) {
+      if (file != nullptr) {
+        return snprintf(buffer, buffer_size, "%s %c %s %5d %5" PRIu64 " %s%.*s%s%s:%u] ", tag,
+                        severity_char, timestamp, pid, tid, brackets.open, brackets.size,
+                        brackets.data, brackets.close, file, line);
+      }
+      return snprintf(buffer, buffer_size, "%s %c %s %5d %5" PRIu64 " %s%.*s%s", tag,
+                      severity_char, timestamp, pid, tid, brackets.open, brackets.size,
+                      brackets.data, brackets.close);
+    };
+    int size = render(buffer_, sizeof(buffer_));
+    if (size < 0) size = 0;
+    size_ = size;
+    data_ = buffer_;
+    if (size_ >= sizeof(buffer_)) {
+      overflow_.resize(size_ + 1);
+      render(overflow_.data(), overflow_.size());
+      overflow_.resize(size_);
+      data_ = overflow_.data();
+    }
+  }
+
+  char buffer_[256];
+  std::string overflow_;
+  const char* data_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(StderrLinePrefix);
+};
+
+// This adds the log header to each line of message and returns it as a string intended to be
+// written to stderr.
+[[maybe_unused]] static std::string StderrOutputGenerator(const StderrLinePrefix& line_prefix,
+                                                          const char* message) {
   auto [size, new_lines] = CountSizeAndNewLines(message);
   std::string output_string;
   output_string.reserve(size + new_lines * line_prefix.size() + 1);
 
   auto concat_lines = [&](const char* message, int size) {
-    output_string.append(line_prefix);
+    output_string.append(line_prefix.data(), line_prefix.size());
     if (size == -1) {
       output_string.append(message);
     } else {
@@ -186,5 +268,98 @@ static std::string StderrOutputGenerator(const struct tm& now, int pid, uint64_t
   return output_string;
 }
 
+[[maybe_unused]] static std::string StderrOutputGenerator(const struct tm& now, int pid,
+                                                          uint64_t tid, LogSeverity severity,
+                                                          const char* tag, const char* file,
+                                                          unsigned int line, const char* message) {
+  return StderrOutputGenerator(StderrLinePrefix(now, pid, tid, severity, tag, file, line), message);
+}
+
+#if !defined(_WIN32)
+// The kernel's printk buffer is only |1024 - PREFIX_MAX| bytes, where
+// PREFIX_MAX could be 48 or 32.
+// Reference: kernel/printk/printk.c
+static constexpr size_t kKernelLogLineMax = 1024 - 48;
+
+// Splits message into /dev/kmsg records, one per line, each of the form "<level>tag: line\n" (or
+// "<level>tag: [context] line\n"), and calls write_record(struct iovec* iov, int count) for
+// each.  The kernel makes a single record of each write, so records can't share a writev();
+// instead, the header is formatted once per message and the lines are never copied.  A line too
+// long for printk is truncated, and followed by a record saying how much of it was lost.
+template <typename F>
+static void KernelLogRecords(int level, const char* tag, std::string_view context,
+                             const char* message, const F& write_record) {
+  LogContextBrackets brackets(context);
+  char header[64];
+  int header_size = snprintf(header, sizeof(header), "<%d>%s: %s%.*s%s", level, tag, brackets.open,
+                             brackets.size, brackets.data, brackets.close);
+  if (header_size < 0) return;
+  std::string long_header;
+  const char* header_data = header;
+  if (static_cast<size_t>(header_size) >= sizeof(header)) {
+    long_header = StringPrintf("<%d>%s: %s%.*s%s", level, tag, brackets.open, brackets.size,
+                               brackets.data, brackets.close);
+    header_data = long_header.data();
+  }
+  // Always leave room for some of the line, and the newline.
+  size_t header_length = std::min(static_cast<size_t>(header_size), kKernelLogLineMax / 2);
+
+  auto write_line = [&](const char* line, int size) {
+    size_t line_length = size == -1 ? strlen(line) : size;
+    size_t record_size = header_size + line_length + 1;
+    size_t max_line_length = kKernelLogLineMax - header_length - 1;
+    struct iovec iov[] = {
+        {const_cast<char*>(header_data), header_length},
+        {const_cast<char*>(line), std::min(line_length, max_line_length)},
+        {const_cast<char*>("\n"), 1},
+    };
+    write_record(iov, 3);
+
+    if (record_size > kKernelLogLineMax) {
+      char notice[kKernelLogLineMax];
+      int notice_size =
+          snprintf(notice, sizeof(notice),
+                   "<%d>%s: **previous message missing %zu bytes** %zu-byte message too long for "
+                   "printk\n",
+                   level, tag, record_size - kKernelLogLineMax, record_size);
+      if (notice_size < 0) return;
+      struct iovec notice_iov = {notice, std::min(static_cast<size_t>(notice_size),
+                                                  sizeof(notice) - 1)};
+      write_record(&notice_iov, 1);
+    }
+  };
+  SplitByLines(message, write_line);
+}
+
+// Produces the same output as StderrOutputGenerator without copying the message: this calls
+// write_iovecs(struct iovec* iov, int count, bool last) with batches of iovecs that point at the
+// prefix and at the lines of the message itself (each line's newline included).  A message of up
+// to kLinesPerBatch lines takes one batch, so it can be written with a single writev().
+template <typename F>
+static void StderrOutputIovecs(const StderrLinePrefix& line_prefix, const char* message,
+                               const F& write_iovecs) {
+  // Well below IOV_MAX, which POSIX requires to be at least 16 and Linux makes 1024.
+  static constexpr int kLinesPerBatch = 64;
+  struct iovec iov[2 * kLinesPerBatch + 1];
+  int count = 0;
+
+  auto add_line = [&](const char* line, int size) {
+    iov[count++] = {const_cast<char*>(line_prefix.data()), line_prefix.size()};
+    if (size == -1) {
+      iov[count++] = {const_cast<char*>(line), strlen(line)};
+      iov[count++] = {const_cast<char*>("\n"), 1};
+    } else {
+      iov[count++] = {const_cast<char*>(line), static_cast<size_t>(size) + 1};
+      if (count == 2 * kLinesPerBatch) {
+        write_iovecs(iov, count, false);
+        count = 0;
+      }
+    }
+  };
+  SplitByLines(message, add_line);
+  write_iovecs(iov, count, true);
+}
+#endif
+
 }  // namespace base
 }  // namespace android
@@ -73,8 +73,9 @@ void TestLogdChunkSplitter(const std::string& tag, const std::string& file,
                            const std::string& input,
                            const std::vector<std::string>& expected_output) {
   std::vector<std::string> output;
-  auto logger_function = [&](LogId, LogSeverity, const char*, const char* msg) {
-    output.push_back(msg);
+  auto logger_function = [&](LogId, LogSeverity, const char*, const char* msg, size_t size) {
+    EXPECT_EQ('\0', msg[size]);
+    output.push_back(std::string(msg, size));
   };
 
   SplitByLogdChunks(MAIN, FATAL, tag.c_str(), file.empty() ? nullptr : file.c_str(), 1000,
@@ -231,12 +232,46 @@ TEST(logging_splitters, LogdChunkSplitter_WithFile) {
   TestLogdChunkSplitter(tag, file, long_strings, expected);
 }
 
+// A message that needs no splitting is passed straight through, without being copied.
+TEST(logging_splitters, LogdChunkSplitter_PassThrough) {
+  std::string message(3000, 'x');
+  const char* output = nullptr;
+  size_t output_size = 0;
+  auto logger_function = [&](LogId, LogSeverity, const char*, const char* msg, size_t size) {
+    output = msg;
+    output_size = size;
+  };
+  SplitByLogdChunks(MAIN, ERROR, "tag", "file.cpp", 1, {}, message.c_str(), message.size(),
+                    logger_function);
+  EXPECT_EQ(message.c_str(), output);
+  EXPECT_EQ(message.size(), output_size);
+}
+
+// A non-empty context is written in brackets at the start of every line, ahead of the file.
+TEST(logging_splitters, LogdChunkSplitter_Context) {
+  std::vector<std::string> output;
+  auto logger_function = [&](LogId, LogSeverity, const char*, const char* msg, size_t size) {
+    EXPECT_EQ('\0', msg[size]);
+    output.push_back(std::string(msg, size));
+  };
+  std::string message = "first\nsecond";
+  SplitByLogdChunks(MAIN, ERROR, "tag", nullptr, 0, "req=42", message.c_str(), message.size(),
+                    logger_function);
+  EXPECT_EQ(std::vector<std::string>{"[req=42] first\n[req=42] second"}, output);
+
+  output.clear();
+  SplitByLogdChunks(MAIN, FATAL, "tag", "file.cpp", 7, "a=1 b=2", message.c_str(), message.size(),
+                    logger_function);
+  EXPECT_EQ(std::vector<std::string>{"[a=1 b=2] file.cpp:7] first\n[a=1 b=2] file.cpp:7] second"},
+            output);
+}
+
 // We set max_size based off of tag, so if it's too large, the buffer will be sized wrong.
 // We could recover from this, but it's certainly an error for someone to attempt to use a tag this
 // large, so we abort instead.
 TEST(logging_splitters, LogdChunkSplitter_TooLongTag) {
   auto long_tag = std::string(5000, 'x');
-  auto logger_function = [](LogId, LogSeverity, const char*, const char*) {};
+  auto logger_function = [](LogId, LogSeverity, const char*, const char*, size_t) {};
   ASSERT_DEATH(
       SplitByLogdChunks(MAIN, ERROR, long_tag.c_str(), nullptr, 0, "message", logger_function), "");
 }
@@ -268,6 +303,25 @@ void TestStderrOutputGenerator(const char* tag, const char* file, int line, cons
 
   auto result = StderrOutputGenerator(now, pid, tid, ERROR, tag, file, line, message);
   EXPECT_EQ(expected, result);
+
+#if !defined(_WIN32)
+  // The iovecs must describe exactly the same output.
+  StderrLinePrefix line_prefix(now, pid, tid, ERROR, tag, file, line);
+  std::string gathered;
+  int batches = 0;
+  bool saw_last = false;
+  auto gather = [&](struct iovec* iov, int count, bool last) {
+    EXPECT_FALSE(saw_last);
+    for (int i = 0; i < count; ++i) {
+      gathered.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    ++batches;
+    saw_last = last;
+  };
+  StderrOutputIovecs(line_prefix, message, gather);
+  EXPECT_TRUE(saw_last);
+  EXPECT_EQ(expected, gathered);
+#endif
 }
 
 TEST(logging_splitters, StderrOutputGenerator_Basic) {
@@ -321,5 +375,92 @@ TEST(logging_splitters, StderrOutputGenerator_MultiLineLong) {
   TestStderrOutputGenerator("tag", nullptr, 0, message.c_str(), expected_result);
 }
 
+TEST(logging_splitters, StderrOutputGenerator_ManyLines) {
+  std::string message;
+  std::string expected_result;
+  for (int i = 0; i < 1000; ++i) {
+    if (i != 0) message += '\n';
+    message += std::to_string(i);
+    expected_result += "tag E 01-01 00:00:00  1234  4321 " + std::to_string(i) + '\n';
+  }
+  TestStderrOutputGenerator("tag", nullptr, 0, message.c_str(), expected_result);
+}
+
+TEST(logging_splitters, StderrOutputGenerator_LongPrefix) {
+  auto long_tag = std::string(1000, 't');
+  auto long_file = std::string(1000, 'f');
+  TestStderrOutputGenerator(
+      long_tag.c_str(), long_file.c_str(), 42, "simple message\n",
+      long_tag + " E 01-01 00:00:00  1234  4321 " + long_file + ":42] simple message\n" +
+          long_tag + " E 01-01 00:00:00  1234  4321 " + long_file + ":42] \n");
+}
+
+TEST(logging_splitters, StderrOutputGenerator_Context) {
+  struct tm now = {};
+  now.tm_mday = 1;
+  now.tm_year = 1970;
+  EXPECT_EQ("tag E 01-01 00:00:00  1234  4321 [req=42] file.cpp:7] first\n"
+            "tag E 01-01 00:00:00  1234  4321 [req=42] file.cpp:7] second\n",
+            StderrOutputGenerator(
+                StderrLinePrefix(now, 1234, 4321, ERROR, "tag", "file.cpp", 7, "req=42"),
+                "first\nsecond"));
+  EXPECT_EQ("tag E 01-01 00:00:00  1234  4321 [a=1 b=2] message\n",
+            StderrOutputGenerator(
+                StderrLinePrefix(now, 1234, 4321, ERROR, "tag", nullptr, 0, "a=1 b=2"), "message"));
+}
+
+#if !defined(_WIN32)
+static std::vector<std::string> KernelRecords(int level, const char* tag, const char* message,
+                                              std::string_view context = {}) {
+  std::vector<std::string> records;
+  auto gather = [&](struct iovec* iov, int count) {
+    std::string record;
+    for (int i = 0; i < count; ++i) {
+      record.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    EXPECT_LE(record.size(), kKernelLogLineMax);
+    records.push_back(record);
+  };
+  KernelLogRecords(level, tag, context, message, gather);
+  return records;
+}
+
+TEST(logging_splitters, KernelLogRecords_Basic) {
+  EXPECT_EQ(std::vector<std::string>{"<6>tag: simple message\n"},
+            KernelRecords(6, "tag", "simple message"));
+}
+
+TEST(logging_splitters, KernelLogRecords_Context) {
+  EXPECT_EQ((std::vector<std::string>{"<6>tag: [req=42] first\n", "<6>tag: [req=42] second\n"}),
+            KernelRecords(6, "tag", "first\nsecond", "req=42"));
+}
+
+TEST(logging_splitters, KernelLogRecords_MultiLine) {
+  EXPECT_EQ((std::vector<std::string>{"<3>tag: first\n", "<3>tag: \n", "<3>tag: second\n",
+                                      "<3>tag: \n"}),
+            KernelRecords(3, "tag", "first\n\nsecond\n"));
+}
+
+TEST(logging_splitters, KernelLogRecords_Truncated) {
+  std::string long_line(2000, 'x');
+  auto records = KernelRecords(2, "tag", (long_line + "\nshort").c_str());
+  ASSERT_EQ(3U, records.size());
+  EXPECT_EQ("<2>tag: " + std::string(kKernelLogLineMax - 9, 'x') + "\n", records[0]);
+  EXPECT_EQ(
+      "<2>tag: **previous message missing 1033 bytes** 2009-byte message too long for printk\n",
+      records[1]);
+  EXPECT_EQ("<2>tag: short\n", records[2]);
+}
+
+TEST(logging_splitters, KernelLogRecords_LongTag) {
+  std::string long_tag(2000, 't');
+  auto records = KernelRecords(6, long_tag.c_str(), "message");
+  ASSERT_EQ(2U, records.size());
+  EXPECT_TRUE(StartsWith(records[0], "<6>ttt"));
+  EXPECT_TRUE(EndsWith(records[0], "tmessage\n"));
+  EXPECT_TRUE(StartsWith(records[1], "<6>ttt"));
+}
+#endif
+
 }  // namespace base
 }  // namespace android
@@ -22,15 +22,26 @@
 #include <signal.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "android-base/file.h"
+#include "android-base/log_statistics.h"
 #include "android-base/scopeguard.h"
 #include "android-base/stringprintf.h"
+#include "android-base/strings.h"
 #include "android-base/test_utils.h"
+#include "recording_logger.h"
 
 #include <gtest/gtest.h>
 
@@ -207,6 +218,168 @@ TEST(logging, WOULD_LOG_VERBOSE_enabled) {
 #undef CHECK_WOULD_LOG_DISABLED
 #undef CHECK_WOULD_LOG_ENABLED
 
+TEST(logging, SetTagMinimumLogSeverity) {
+  android::base::ScopedLogSeverity sls(android::base::WARNING);
+  auto clear = android::base::make_scope_guard(android::base::ClearTagMinimumLogSeverities);
+  android::base::SetTagMinimumLogSeverity("noisy", android::base::VERBOSE);
+  android::base::SetTagMinimumLogSeverity("chatty", android::base::ERROR);
+
+  EXPECT_TRUE(android::base::ShouldLog(android::base::VERBOSE, "noisy"));
+  EXPECT_FALSE(android::base::ShouldLog(android::base::WARNING, "chatty"));
+  EXPECT_TRUE(android::base::ShouldLog(android::base::ERROR, "chatty"));
+  EXPECT_FALSE(android::base::ShouldLog(android::base::INFO, "other"));
+  EXPECT_TRUE(android::base::ShouldLog(android::base::WARNING, "other"));
+  EXPECT_FALSE(android::base::ShouldLog(android::base::INFO, "nois"));
+  EXPECT_FALSE(android::base::ShouldLog(android::base::INFO, "noisy2"));
+
+  android::base::ClearTagMinimumLogSeverities();
+  EXPECT_FALSE(android::base::ShouldLog(android::base::VERBOSE, "noisy"));
+  EXPECT_TRUE(android::base::ShouldLog(android::base::WARNING, "chatty"));
+}
+
+TEST(logging, SetTagMinimumLogSeverity_many_tags) {
+  android::base::ScopedLogSeverity sls(android::base::INFO);
+  auto clear = android::base::make_scope_guard(android::base::ClearTagMinimumLogSeverities);
+  for (int i = 0; i < 1000; i += 2) {
+    android::base::SetTagMinimumLogSeverity(std::to_string(i), android::base::VERBOSE);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    std::string tag = std::to_string(i);
+    EXPECT_EQ(i % 2 == 0, android::base::ShouldLog(android::base::VERBOSE, tag.c_str())) << tag;
+  }
+}
+
+TEST(logging, SetTagMinimumLogSeverity_default_tag) {
+  android::base::ScopedLogSeverity sls(android::base::INFO);
+  auto clear = android::base::make_scope_guard(android::base::ClearTagMinimumLogSeverities);
+  android::base::SetDefaultTag("default-tag");
+  android::base::SetTagMinimumLogSeverity("default-tag", android::base::VERBOSE);
+  EXPECT_TRUE(WOULD_LOG(VERBOSE));
+
+  android::base::SetDefaultTag("another-default-tag");
+  EXPECT_FALSE(WOULD_LOG(VERBOSE));
+  android::base::SetDefaultTag("");
+}
+
+TEST(logging, SetTagMinimumLogSeverity_LOG_TAG) {
+  android::base::ScopedLogSeverity sls(android::base::INFO);
+  auto clear = android::base::make_scope_guard(android::base::ClearTagMinimumLogSeverities);
+  android::base::SetTagMinimumLogSeverity("noisy", android::base::VERBOSE);
+
+  CapturedStderr cap;
+#pragma push_macro("_LOG_TAG_INTERNAL")
+#undef _LOG_TAG_INTERNAL
+#define _LOG_TAG_INTERNAL "noisy"
+  LOG(VERBOSE) << "verbose from noisy";
+#pragma pop_macro("_LOG_TAG_INTERNAL")
+  LOG(VERBOSE) << "verbose from untagged";
+  LOG(INFO) << "info from untagged";
+  cap.Stop();
+
+  std::string output = cap.str();
+  EXPECT_NE(std::string::npos, output.find("verbose from noisy")) << output;
+  EXPECT_EQ(std::string::npos, output.find("verbose from untagged")) << output;
+  EXPECT_NE(std::string::npos, output.find("info from untagged")) << output;
+}
+
+TEST(logging, SetTagMinimumLogSeverity_call_site_cache) {
+  android::base::ScopedLogSeverity sls(android::base::INFO);
+  auto clear = android::base::make_scope_guard([] {
+    android::base::ClearTagMinimumLogSeverities();
+    android::base::SetDefaultTag("");
+  });
+  // Each of these is a single call site, which caches its tag's minimum severity; it must see
+  // every later change.
+#pragma push_macro("_LOG_TAG_INTERNAL")
+#undef _LOG_TAG_INTERNAL
+#define _LOG_TAG_INTERNAL "noisy"
+  auto noisy_would_log_verbose = [] { return WOULD_LOG(VERBOSE); };
+#pragma pop_macro("_LOG_TAG_INTERNAL")
+  auto untagged_would_log_verbose = [] { return WOULD_LOG(VERBOSE); };
+
+  EXPECT_FALSE(noisy_would_log_verbose());
+  EXPECT_FALSE(untagged_would_log_verbose());
+  android::base::SetTagMinimumLogSeverity("noisy", android::base::VERBOSE);
+  EXPECT_TRUE(noisy_would_log_verbose());
+  EXPECT_FALSE(untagged_would_log_verbose());
+  android::base::SetDefaultTag("noisy");
+  EXPECT_TRUE(untagged_would_log_verbose());
+  android::base::SetTagMinimumLogSeverity("noisy", android::base::ERROR);
+  EXPECT_FALSE(noisy_would_log_verbose());
+  EXPECT_FALSE(untagged_would_log_verbose());
+  android::base::ClearTagMinimumLogSeverities();
+  EXPECT_FALSE(noisy_would_log_verbose());
+  android::base::SetMinimumLogSeverity(android::base::VERBOSE);
+  EXPECT_TRUE(noisy_would_log_verbose());
+}
+
+static const char* gVariableLogTag;
+
+TEST(logging, SetTagMinimumLogSeverity_variable_LOG_TAG) {
+  android::base::ScopedLogSeverity sls(android::base::INFO);
+  auto clear = android::base::make_scope_guard(android::base::ClearTagMinimumLogSeverities);
+  android::base::SetTagMinimumLogSeverity("b", android::base::ERROR);
+
+  // A LOG_TAG that isn't a literal can change between visits to the same call site.
+#pragma push_macro("_LOG_TAG_INTERNAL")
+#undef _LOG_TAG_INTERNAL
+#define _LOG_TAG_INTERNAL gVariableLogTag
+  auto log_info = [](const char* tag) {
+    gVariableLogTag = tag;
+    LOG(INFO) << "info from " << tag;
+  };
+#pragma pop_macro("_LOG_TAG_INTERNAL")
+
+  CapturedStderr cap;
+  log_info("a");
+  log_info("b");
+  log_info("a");
+  cap.Stop();
+
+  std::string output = cap.str();
+  EXPECT_NE(std::string::npos, output.find("info from a")) << output;
+  EXPECT_EQ(std::string::npos, output.find("info from b")) << output;
+}
+
+// InitLogging() only reads ANDROID_LOG_TAGS the first time it's called, which is in main(), so
+// these tests check it in a freshly executed child process.
+TEST(logging, InitLogging_ANDROID_LOG_TAGS) {
+  std::string old_style = ::testing::GTEST_FLAG(death_test_style);
+  ::testing::GTEST_FLAG(death_test_style) = "threadsafe";
+  auto restore = android::base::make_scope_guard([&old_style] {
+    ::testing::GTEST_FLAG(death_test_style) = old_style;
+    unsetenv("ANDROID_LOG_TAGS");
+  });
+  setenv("ANDROID_LOG_TAGS", "*:w  noisy:v quiet:s bare", 1);
+
+  EXPECT_EXIT(
+      {
+        using android::base::ShouldLog;
+        bool ok = android::base::GetMinimumLogSeverity() == android::base::WARNING &&
+                  !ShouldLog(android::base::INFO, "other") &&
+                  ShouldLog(android::base::VERBOSE, "noisy") &&
+                  ShouldLog(android::base::VERBOSE, "bare") &&
+                  !ShouldLog(android::base::ERROR, "quiet") &&
+                  ShouldLog(android::base::FATAL_WITHOUT_ABORT, "quiet");
+        _exit(ok ? 0 : 1);
+      },
+      ::testing::ExitedWithCode(0), "");
+}
+
+TEST(logging, InitLogging_ANDROID_LOG_TAGS_unsupported) {
+  std::string old_style = ::testing::GTEST_FLAG(death_test_style);
+  ::testing::GTEST_FLAG(death_test_style) = "threadsafe";
+  auto restore = android::base::make_scope_guard([&old_style] {
+    ::testing::GTEST_FLAG(death_test_style) = old_style;
+    unsetenv("ANDROID_LOG_TAGS");
+  });
+
+  setenv("ANDROID_LOG_TAGS", "*:v noisy:x", 1);
+  ASSERT_DEATH({}, "unsupported 'noisy:x' in ANDROID_LOG_TAGS");
+  setenv("ANDROID_LOG_TAGS", ":v", 1);
+  ASSERT_DEATH({}, "unsupported ':v' in ANDROID_LOG_TAGS");
+}
+
 
 #if !defined(_WIN32)
 static std::string make_log_pattern(android::base::LogSeverity severity,
@@ -479,6 +652,38 @@ TEST(logging, LOG_does_not_have_dangling_if) {
   EXPECT_FALSE(flag) << "LOG macro probably has a dangling if with no else";
 }
 
+TEST(logging, LOG_long_message) {
+  // Longer than any buffer the per-thread cache keeps, to exercise growing and discarding it.
+  std::string long_message(100 * 1024, 'x');
+  for (int i = 0; i < 3; ++i) {
+    CapturedStderr cap;
+    LOG(INFO) << "start" << long_message << "end";
+    cap.Stop();
+    std::string output = cap.str();
+    ASSERT_NE(std::string::npos, output.find("] start" + long_message + "end\n"));
+  }
+}
+
+namespace {
+
+struct LogsWhenStreamed {};
+
+std::ostream& operator<<(std::ostream& os, const LogsWhenStreamed&) {
+  LOG(INFO) << "inner";
+  return os << "streamed";
+}
+
+}  // namespace
+
+TEST(logging, LOG_while_building_another_message) {
+  CapturedStderr cap;
+  LOG(INFO) << "outer " << LogsWhenStreamed() << " done";
+  cap.Stop();
+  std::string output = cap.str();
+  ASSERT_NO_FATAL_FAILURE(CheckMessage(output, android::base::INFO, "inner"));
+  ASSERT_NO_FATAL_FAILURE(CheckMessage(output, android::base::INFO, "outer streamed done"));
+}
+
 #define CHECK_PLOG_DISABLED(severity)                            \
   {                                                              \
     android::base::ScopedLogSeverity sls1(android::base::FATAL); \
@@ -705,3 +910,837 @@ TEST(logging, ForkSafe) {
   }
 #endif
 }
+
+TEST(logging, AsyncLogger_preserves_order) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  AsyncLogger logger(recorder.Function(), 4);
+
+  for (int i = 0; i < 100; ++i) {
+    logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, std::to_string(i).c_str());
+  }
+  logger.Flush();
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(100U, messages.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(std::to_string(i), messages[i].second);
+  }
+  EXPECT_EQ(0U, logger.GetDroppedCount());
+}
+
+TEST(logging, AsyncLogger_fatal_is_synchronous) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  AsyncLogger logger(recorder.Function());
+
+  logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, "first");
+  logger(DEFAULT, WARNING, "tag", __FILE__, __LINE__, "second");
+  logger(DEFAULT, FATAL, "tag", __FILE__, __LINE__, "fatal");
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(3U, messages.size());
+  EXPECT_EQ("first", messages[0].second);
+  EXPECT_EQ("second", messages[1].second);
+  EXPECT_EQ(FATAL, messages[2].first);
+  EXPECT_EQ("fatal", messages[2].second);
+}
+
+TEST(logging, AsyncLogger_drop_newest) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  recorder.stalled = true;
+  AsyncLogger logger(recorder.Function(), 2, AsyncLogger::OverflowPolicy::kDropNewest);
+
+  // The writer thread holds at most one message while stalled, so only the queue's two slots
+  // and that one message can be accepted.
+  for (int i = 0; i < 10; ++i) {
+    logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, std::to_string(i).c_str());
+  }
+  EXPECT_GE(logger.GetDroppedCount(), 7U);
+
+  recorder.Release();
+  logger.Flush();
+  logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, "after");
+  logger.Flush();
+
+  auto messages = recorder.Messages();
+  ASSERT_FALSE(messages.empty());
+  EXPECT_EQ("after", messages.back().second);
+  auto first = std::find_if(messages.begin(), messages.end(),
+                            [](const auto& message) { return message.second == "0"; });
+  EXPECT_NE(messages.end(), first);
+  auto report = std::find_if(messages.begin(), messages.end(), [](const auto& message) {
+    return message.first == WARNING &&
+           message.second.find("AsyncLogger dropped") != std::string::npos;
+  });
+  EXPECT_NE(messages.end(), report);
+}
+
+TEST(logging, AsyncLogger_drop_oldest) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  recorder.stalled = true;
+  AsyncLogger logger(recorder.Function(), 2, AsyncLogger::OverflowPolicy::kDropOldest);
+
+  for (int i = 0; i < 10; ++i) {
+    logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, std::to_string(i).c_str());
+  }
+  recorder.Release();
+  logger.Flush();
+
+  EXPECT_GE(logger.GetDroppedCount(), 7U);
+  auto messages = recorder.Messages();
+  ASSERT_FALSE(messages.empty());
+  EXPECT_EQ("9", messages.back().second);
+}
+
+TEST(logging, AsyncLogger_SetLogger) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  AsyncLogger async_logger(recorder.Function());
+  LogFunction old_logger = SetLogger(async_logger);
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 100; ++j) LOG(INFO) << "from a thread";
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  async_logger.Flush();
+
+  EXPECT_EQ(400U, recorder.Messages().size());
+}
+
+TEST(logging, AsyncLogger_fatal_waits_for_messages_being_queued) {
+  using namespace android::base;
+  // Each thread logs an increasing count, and publishes the last one that was accepted.  Whatever
+  // was accepted before a FATAL message is logged must be written ahead of it, even if a thread
+  // that's still copying a message into the queue sits in front of it.
+  constexpr int kThreads = 4;
+  std::atomic<int> accepted[kThreads] = {};
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<int>> fatal_snapshots;
+  std::vector<int> written(kThreads, 0);
+  AsyncLogger logger([&](LogId, LogSeverity severity, const char*, const char*, unsigned int,
+                         const char* message) {
+    if (severity == FATAL_WITHOUT_ABORT) {
+      fatal_snapshots.emplace_back(written);
+      return;
+    }
+    int thread, count;
+    ASSERT_EQ(2, sscanf(message, "%d:%d", &thread, &count));
+    written[thread] = count;
+  });
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (int count = 1; !stop.load(); ++count) {
+        logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, StringPrintf("%d:%d", i, count).c_str());
+        accepted[i].store(count);
+      }
+    });
+  }
+  std::vector<std::vector<int>> expected;
+  for (int i = 0; i < 200; ++i) {
+    std::vector<int> snapshot;
+    for (auto& count : accepted) snapshot.push_back(count.load());
+    logger(DEFAULT, FATAL_WITHOUT_ABORT, "tag", __FILE__, __LINE__, "fatal");
+    expected.emplace_back(std::move(snapshot));
+  }
+  stop = true;
+  for (auto& thread : threads) thread.join();
+
+  ASSERT_EQ(expected.size(), fatal_snapshots.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    for (int thread = 0; thread < kThreads; ++thread) {
+      ASSERT_GE(fatal_snapshots[i][thread], expected[i][thread]) << i << " " << thread;
+    }
+  }
+}
+
+TEST(logging, AsyncLogger_destroyed_on_writer_thread) {
+  using namespace android::base;
+  // The wrapped logger drops the last reference to the AsyncLogger, as one that calls SetLogger()
+  // might, which mustn't pull the state out from under the writer thread.
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool logged = false;
+  bool destroyed = false;
+  std::shared_ptr<void> sentinel(nullptr, [&](void*) {
+    std::lock_guard<std::mutex> lock(mutex);
+    destroyed = true;
+    cv.notify_all();
+  });
+  std::unique_ptr<AsyncLogger> logger;
+  logger.reset(new AsyncLogger([&, sentinel](LogId, LogSeverity, const char*, const char*,
+                                             unsigned int, const char*) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return logged; });
+    }
+    logger.reset();
+  }));
+  sentinel.reset();
+
+  (*logger)(DEFAULT, INFO, "tag", __FILE__, __LINE__, "first");
+  std::unique_lock<std::mutex> lock(mutex);
+  logged = true;
+  cv.notify_all();
+  // The wrapped logger, and with it the sentinel, goes once the writer thread has finished.
+  EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&] { return destroyed; }));
+}
+
+TEST(logging, ScopedLogContext) {
+  using namespace android::base;
+  EXPECT_EQ("", GetLogContext());
+  {
+    ScopedLogContext request("req", 42);
+    EXPECT_EQ("req=42", GetLogContext());
+    {
+      ScopedLogContext user("user", "alice");
+      ScopedLogContext negative("n", -7LL);
+      EXPECT_EQ("req=42 user=alice n=-7", GetLogContext());
+    }
+    EXPECT_EQ("req=42", GetLogContext());
+
+    // Other threads have their own fields.
+    std::thread([] { EXPECT_EQ("", GetLogContext()); }).join();
+  }
+  EXPECT_EQ("", GetLogContext());
+}
+
+TEST(logging, ScopedLogContext_overflow) {
+  using namespace android::base;
+  std::vector<std::unique_ptr<ScopedLogContext>> contexts;
+  for (size_t i = 0; i < ScopedLogContext::kMaxFields + 4; ++i) {
+    contexts.emplace_back(new ScopedLogContext("k", i));
+  }
+  // Fields beyond the limit are dropped.
+  EXPECT_TRUE(EndsWith(GetLogContext(), " k=15")) << GetLogContext();
+
+  // So are fields that don't fit; destroying them leaves the rest intact.
+  while (!contexts.empty()) contexts.pop_back();
+  ScopedLogContext small("small", 1);
+  {
+    ScopedLogContext big("big", std::string(ScopedLogContext::kMaxSize, 'x'));
+    EXPECT_EQ("small=1", GetLogContext());
+  }
+  EXPECT_EQ("small=1", GetLogContext());
+}
+
+#if !defined(_WIN32)
+TEST(logging, ScopedLogContext_StderrLogger) {
+  using namespace android::base;
+  LogFunction old_logger = SetLogger(StderrLogger);
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  CapturedStderr cap;
+  {
+    ScopedLogContext context("req", 42);
+    LOG(INFO) << "first\nsecond";
+  }
+  LOG(INFO) << "third";
+  cap.Stop();
+  EXPECT_TRUE(std::regex_search(cap.str(), std::regex(" \\[req=42\\] [^ ]+:\\d+] first\n")))
+      << cap.str();
+  EXPECT_TRUE(std::regex_search(cap.str(), std::regex(" \\[req=42\\] [^ ]+:\\d+] second\n")))
+      << cap.str();
+  EXPECT_TRUE(std::regex_search(cap.str(), std::regex(" \\d+ [^ \\[]+:\\d+] third\n")))
+      << cap.str();
+}
+#endif
+
+TEST(logging, AsyncLogger_carries_context) {
+  using namespace android::base;
+  std::mutex mutex;
+  std::vector<std::string> contexts;
+  AsyncLogger logger([&](LogId, LogSeverity, const char*, const char*, unsigned int,
+                         const char*) {
+    std::lock_guard<std::mutex> lock(mutex);
+    contexts.emplace_back(GetLogContext());
+  });
+
+  {
+    ScopedLogContext context("req", 42);
+    logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, "first");
+  }
+  logger(DEFAULT, INFO, "tag", __FILE__, __LINE__, "second");
+  logger.Flush();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ((std::vector<std::string>{"req=42", ""}), contexts);
+}
+
+TEST(logging, LOG_EVERY_N) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  for (int i = 0; i < 10; ++i) {
+    LOG_EVERY_N(INFO, 4) << i;
+  }
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(3U, messages.size());
+  EXPECT_EQ("0", messages[0].second);
+  EXPECT_EQ("(3 suppressed) 4", messages[1].second);
+  EXPECT_EQ("(3 suppressed) 8", messages[2].second);
+}
+
+TEST(logging, LOG_EVERY_N_disabled_severity_is_not_counted) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  for (int i = 0; i < 3; ++i) {
+    ScopedLogSeverity sls(i == 1 ? INFO : WARNING);
+    LOG_EVERY_N(INFO, 2) << i;
+  }
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(1U, messages.size());
+  EXPECT_EQ("1", messages[0].second);
+}
+
+TEST(logging, LOG_FIRST_N) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  int evaluated = 0;
+  for (int i = 0; i < 10; ++i) {
+    LOG_FIRST_N(WARNING, 3) << i << (++evaluated, "");
+  }
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(3U, messages.size());
+  EXPECT_EQ("0", messages[0].second);
+  EXPECT_EQ("1", messages[1].second);
+  EXPECT_EQ("2", messages[2].second);
+  EXPECT_EQ(WARNING, messages[2].first);
+  EXPECT_EQ(3, evaluated);
+}
+
+TEST(logging, LOG_EVERY_T) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  for (int i = 0; i < 10; ++i) {
+    LOG_EVERY_T(INFO, std::chrono::hours(1)) << "hourly " << i;
+    LOG_EVERY_T(INFO, std::chrono::nanoseconds(0)) << "always " << i;
+  }
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(11U, messages.size());
+  EXPECT_EQ("hourly 0", messages[0].second);
+  EXPECT_EQ("always 9", messages[10].second);
+}
+
+TEST(logging, LOG_EVERY_T_reports_suppressed) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      LOG_EVERY_T(INFO, std::chrono::milliseconds(100)) << i;
+    }
+    if (i == 0) std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  }
+
+  auto messages = recorder.Messages();
+  ASSERT_EQ(2U, messages.size());
+  EXPECT_EQ("0", messages[0].second);
+  EXPECT_EQ("(4 suppressed) 1", messages[1].second);
+}
+
+TEST(logging, LOG_SAMPLED) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  for (int i = 0; i < 100; ++i) {
+    LOG_SAMPLED(INFO, 0.0) << "never";
+    LOG_SAMPLED(INFO, 1.0) << "always";
+  }
+  auto messages = recorder.Messages();
+  ASSERT_EQ(100U, messages.size());
+  EXPECT_EQ("always", messages[99].second);
+
+  recorder.Clear();
+  for (int i = 0; i < 10000; ++i) {
+    LOG_SAMPLED(INFO, 0.1) << "sometimes";
+  }
+  messages = recorder.Messages();
+  EXPECT_GT(messages.size(), 500U);
+  EXPECT_LT(messages.size(), 1500U);
+
+  // Every suppressed message is accounted for by the next logged one.
+  size_t total = messages.size();
+  for (const auto& [severity, message] : messages) {
+    unsigned long long suppressed;
+    if (sscanf(message.c_str(), "(%llu suppressed)", &suppressed) == 1) total += suppressed;
+  }
+  EXPECT_LE(total, 10000U);
+  EXPECT_GT(total, 10000U - 100U);
+}
+
+#if !defined(_WIN32)
+TEST(logging, SetStderrLogTimestampFormat) {
+  using namespace android::base;
+  LogFunction old_logger = SetLogger(StderrLogger);
+  auto guard = make_scope_guard([&] {
+    SetLogger(std::move(old_logger));
+    SetStderrLogTimestampFormat(LogTimestampFormat::kSeconds);
+  });
+
+  auto check = [](LogTimestampFormat format, const char* timestamp_regex) {
+    EXPECT_EQ(LogTimestampFormat::kSeconds, SetStderrLogTimestampFormat(format));
+    CapturedStderr cap;
+    LOG(INFO) << "first";
+    LOG(INFO) << "second";
+    cap.Stop();
+    SetStderrLogTimestampFormat(LogTimestampFormat::kSeconds);
+    std::string pattern = std::string(" I \\d\\d-\\d\\d \\d\\d:\\d\\d:\\d\\d") + timestamp_regex +
+                          " \\s*\\d+ \\s*\\d+ [^ ]+:\\d+] ";
+    EXPECT_TRUE(std::regex_search(cap.str(), std::regex(pattern + "first\n"))) << cap.str();
+    EXPECT_TRUE(std::regex_search(cap.str(), std::regex(pattern + "second\n"))) << cap.str();
+  };
+  check(LogTimestampFormat::kSeconds, "");
+  check(LogTimestampFormat::kMilliseconds, "\\.\\d{3}");
+  check(LogTimestampFormat::kMicroseconds, "\\.\\d{6}");
+}
+
+TEST(logging, StderrLogger_pipe_messages_are_not_interleaved) {
+  using namespace android::base;
+  // A pipe only writes up to PIPE_BUF bytes atomically, so these messages (one of them small
+  // enough for a single writev(), the other not) rely on StderrLogger's own locking.
+  LogFunction old_logger = SetLogger(StderrLogger);
+  auto guard = make_scope_guard([&] { SetLogger(std::move(old_logger)); });
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  std::string output;
+  std::thread reader([&] {
+    char buf[BUFSIZ];
+    ssize_t n;
+    while ((n = TEMP_FAILURE_RETRY(read(fds[0], buf, sizeof(buf)))) > 0) output.append(buf, n);
+    close(fds[0]);
+  });
+  int old_stderr = dup(STDERR_FILENO);
+  ASSERT_NE(-1, old_stderr);
+  ASSERT_NE(-1, dup2(fds[1], STDERR_FILENO));
+  close(fds[1]);
+
+  constexpr int kThreads = 4;
+  constexpr int kMessages = 20;
+  const size_t kLines[] = {40, 200};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int m = 0; m < kMessages; ++m) {
+        std::string message;
+        for (size_t l = 0; l < kLines[m % 2]; ++l) {
+          if (l != 0) message += '\n';
+          message += StringPrintf("%d %d %zu ", t, m, l) + std::string(150, 'x');
+        }
+        LOG(INFO) << message;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  dup2(old_stderr, STDERR_FILENO);
+  close(old_stderr);
+  reader.join();
+
+  // Every line of a message must directly follow the one before it.
+  int lines = 0;
+  int t = 0, m = 0;
+  size_t l = 0;
+  for (const auto& line : Split(output, "\n")) {
+    if (line.empty()) continue;
+    size_t body = line.find("] ");
+    ASSERT_NE(std::string::npos, body) << line;
+    int line_t, line_m;
+    size_t line_l;
+    ASSERT_EQ(3, sscanf(line.c_str() + body + 2, "%d %d %zu ", &line_t, &line_m, &line_l)) << line;
+    if (line_l == 0) {
+      if (lines != 0) {
+        ASSERT_EQ(kLines[m % 2] - 1, l) << line;
+      }
+    } else {
+      ASSERT_EQ(t, line_t) << line;
+      ASSERT_EQ(m, line_m) << line;
+      ASSERT_EQ(l + 1, line_l) << line;
+    }
+    t = line_t;
+    m = line_m;
+    l = line_l;
+    ++lines;
+  }
+  EXPECT_EQ(kThreads * kMessages / 2 * (kLines[0] + kLines[1]), static_cast<size_t>(lines));
+}
+#endif
+
+static std::vector<std::string> ListDir(const std::string& dir) {
+  std::vector<std::string> names;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    names.push_back(entry.path().filename().string());
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+TEST(logging, FileLogger) {
+  using namespace android::base;
+  TemporaryDir dir;
+  std::string path = std::string(dir.path) + "/log";
+  FileLogger logger(path);
+
+  logger(DEFAULT, INFO, "tag", "file.cpp", 42, "first\nsecond");
+  // Buffered messages aren't written until they're flushed...
+  std::string content;
+  ASSERT_TRUE(ReadFileToString(path, &content));
+  EXPECT_EQ("", content);
+  // ...unless they're ERROR or above.
+  logger(DEFAULT, ERROR, nullptr, nullptr, 0, "third");
+  ASSERT_TRUE(ReadFileToString(path, &content));
+
+#if !defined(_WIN32)
+  EXPECT_TRUE(std::regex_match(
+      content, std::regex("tag I \\d+-\\d+ \\d+:\\d+:\\d+ \\s*\\d+ \\s*\\d+ file.cpp:42] first\n"
+                          "tag I \\d+-\\d+ \\d+:\\d+:\\d+ \\s*\\d+ \\s*\\d+ file.cpp:42] second\n"
+                          "nullptr E \\d+-\\d+ \\d+:\\d+:\\d+ \\s*\\d+ \\s*\\d+ third\n")))
+      << content;
+#endif
+
+  // A new logger appends to the existing file.
+  FileLogger another_logger(path);
+  another_logger(DEFAULT, INFO, "tag", nullptr, 0, "fourth");
+  another_logger.Flush();
+  std::string new_content;
+  ASSERT_TRUE(ReadFileToString(path, &new_content));
+  EXPECT_EQ(0U, new_content.find(content)) << new_content;
+  EXPECT_TRUE(EndsWith(new_content, " fourth\n")) << new_content;
+}
+
+TEST(logging, FileLogger_flush_interval) {
+  using namespace android::base;
+  TemporaryDir dir;
+  std::string path = std::string(dir.path) + "/log";
+  FileLogger::Options options;
+  options.flush_interval = std::chrono::milliseconds(10);
+  FileLogger logger(path, options);
+
+  logger(DEFAULT, INFO, "tag", nullptr, 0, "message");
+  std::string content;
+  for (int i = 0; i < 500 && content.empty(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(ReadFileToString(path, &content));
+  }
+  EXPECT_TRUE(EndsWith(content, " message\n")) << content;
+}
+
+TEST(logging, FileLogger_size_rotation) {
+  using namespace android::base;
+  TemporaryDir dir;
+  std::string path = std::string(dir.path) + "/log";
+  FileLogger::Options options;
+  options.max_file_size = 1000;
+  options.max_rotated_files = 3;
+  options.buffer_size = 300;
+  std::vector<std::string> compressed;
+  options.compress = [&compressed](const std::string& rotated_path) {
+    std::string compressed_path = rotated_path + ".z";
+    EXPECT_EQ(0, rename(rotated_path.c_str(), compressed_path.c_str()));
+    compressed.push_back(compressed_path);
+    return compressed_path;
+  };
+
+  {
+    FileLogger logger(path, options);
+    for (int i = 0; i < 100; ++i) {
+      logger(DEFAULT, INFO, "tag", nullptr, 0, StringPrintf("message %d", i).c_str());
+    }
+    logger.Flush();
+    EXPECT_GT(compressed.size(), 3U);
+
+    // Only the newest three rotated files are kept, next to the current file.
+    auto names = ListDir(dir.path);
+    ASSERT_EQ(4U, names.size());
+    EXPECT_EQ("log", names[0]);
+    for (size_t i = 0; i < 3; ++i) {
+      EXPECT_EQ(compressed[compressed.size() - 3 + i],
+                std::string(dir.path) + "/" + names[i + 1]);
+    }
+
+    // No file exceeds the limit, and the newest one holds the newest messages.
+    for (const auto& name : names) {
+      std::string content;
+      ASSERT_TRUE(ReadFileToString(std::string(dir.path) + "/" + name, &content));
+      EXPECT_LE(content.size(), 1000U) << name;
+    }
+    std::string content;
+    ASSERT_TRUE(ReadFileToString(path, &content));
+    EXPECT_TRUE(EndsWith(content, " message 99\n")) << content;
+  }
+}
+
+TEST(logging, FileLogger_time_rotation) {
+  using namespace android::base;
+  TemporaryDir dir;
+  std::string path = std::string(dir.path) + "/log";
+  FileLogger::Options options;
+  options.rotation_interval = std::chrono::seconds(1);
+  FileLogger logger(path, options);
+
+  logger(DEFAULT, ERROR, "tag", nullptr, 0, "before");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  logger(DEFAULT, ERROR, "tag", nullptr, 0, "after");
+  logger.Flush();
+
+  auto names = ListDir(dir.path);
+  ASSERT_EQ(2U, names.size());
+  std::string content;
+  ASSERT_TRUE(ReadFileToString(path, &content));
+  EXPECT_TRUE(EndsWith(content, " after\n")) << content;
+  ASSERT_TRUE(ReadFileToString(std::string(dir.path) + "/" + names[1], &content));
+  EXPECT_TRUE(EndsWith(content, " before\n")) << content;
+}
+
+TEST(logging, FileLogger_destroyed_on_background_thread) {
+  using namespace android::base;
+  // `compress` drops the last reference to the FileLogger, as one that calls SetLogger() might,
+  // which mustn't pull the state out from under the background thread.
+  TemporaryDir dir;
+  std::string path = std::string(dir.path) + "/log";
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool logged = false;
+  bool destroyed = false;
+  std::shared_ptr<void> sentinel(nullptr, [&](void*) {
+    std::lock_guard<std::mutex> lock(mutex);
+    destroyed = true;
+    cv.notify_all();
+  });
+  std::unique_ptr<FileLogger> logger;
+  FileLogger::Options options;
+  options.max_file_size = 10;
+  options.compress = [&, sentinel](const std::string& rotated_path) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return logged; });
+    }
+    logger.reset();
+    return rotated_path;
+  };
+  logger.reset(new FileLogger(path, options));
+  options.compress = nullptr;
+  sentinel.reset();
+
+  (*logger)(DEFAULT, ERROR, "tag", nullptr, 0, "first");
+  (*logger)(DEFAULT, ERROR, "tag", nullptr, 0, "second");
+  (*logger)(DEFAULT, INFO, "tag", nullptr, 0, "buffered");
+  std::unique_lock<std::mutex> lock(mutex);
+  logged = true;
+  cv.notify_all();
+  // The state, and with it the sentinel, goes once the background thread has finished, and
+  // writes out what was still buffered.
+  ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&] { return destroyed; }));
+  std::string content;
+  ASSERT_TRUE(ReadFileToString(path, &content));
+  EXPECT_TRUE(EndsWith(content, " buffered\n")) << content;
+}
+
+TEST(logging, LogStatistics) {
+  using namespace android::base;
+  RecordingLogger recorder;
+  LogFunction old_logger = SetLogger(recorder.Function());
+  ScopedLogSeverity sls(WARNING);
+  SetLogStatisticsEnabled(true);
+  ResetLogStatistics();
+  auto guard = make_scope_guard([&] {
+    SetLogStatisticsEnabled(false);
+    ResetLogStatistics();
+    SetLogger(std::move(old_logger));
+  });
+
+  LOG(WARNING) << "12345";
+  LOG(ERROR) << "123";
+  LOG(INFO) << "suppressed";
+  LogMessage::LogLine(nullptr, 0, WARNING, "stats_tag", "1234567");
+  EXPECT_FALSE(ShouldLog(DEBUG, "stats_tag"));
+
+  LogStatistics statistics = GetLogStatistics();
+  EXPECT_EQ(2U, statistics.severities[WARNING].emitted);
+  EXPECT_EQ(12U, statistics.severities[WARNING].bytes);
+  EXPECT_EQ(1U, statistics.severities[ERROR].emitted);
+  EXPECT_EQ(3U, statistics.severities[ERROR].bytes);
+  EXPECT_EQ(1U, statistics.severities[INFO].suppressed);
+  EXPECT_EQ(0U, statistics.severities[INFO].emitted);
+  EXPECT_EQ(1U, statistics.severities[DEBUG].suppressed);
+
+  ASSERT_EQ(1U, statistics.tags.count("stats_tag"));
+  EXPECT_EQ(1U, statistics.tags["stats_tag"].emitted);
+  EXPECT_EQ(1U, statistics.tags["stats_tag"].suppressed);
+  EXPECT_EQ(7U, statistics.tags["stats_tag"].bytes);
+
+  // Only the LOG statements that were written are timed.
+  uint64_t timed = 0;
+  for (uint64_t count : statistics.latency[WARNING]) timed += count;
+  EXPECT_EQ(1U, timed);
+
+  std::string formatted = FormatLogStatistics(statistics);
+  EXPECT_NE(std::string::npos, formatted.find("stats_tag")) << formatted;
+
+  ResetLogStatistics();
+  statistics = GetLogStatistics();
+  EXPECT_EQ(0U, statistics.severities[WARNING].emitted);
+  EXPECT_EQ(0U, statistics.tags.count("stats_tag"));
+
+  // Nothing is counted while statistics are disabled.
+  SetLogStatisticsEnabled(false);
+  LOG(WARNING) << "uncounted";
+  EXPECT_EQ(0U, GetLogStatistics().severities[WARNING].emitted);
+}
+
+TEST(logging, ResetLogStatistics_frees_tags) {
+  using namespace android::base;
+  LogFunction old_logger = SetLogger([](LogId, LogSeverity, const char*, const char*, unsigned int,
+                                        const char*) {});
+  SetLogStatisticsEnabled(true);
+  ResetLogStatistics();
+  auto guard = make_scope_guard([&] {
+    SetLogStatisticsEnabled(false);
+    ResetLogStatistics();
+    SetLogger(std::move(old_logger));
+  });
+
+  // Use up every tag's counters, so that further tags are only counted as "(other)".
+  for (size_t i = 0; i < LogStatistics::kMaxTags; ++i) {
+    LogMessage::LogLine(nullptr, 0, WARNING, ("full" + std::to_string(i)).c_str(), "x");
+  }
+  LogMessage::LogLine(nullptr, 0, WARNING, "late", "x");
+  LogStatistics statistics = GetLogStatistics();
+  EXPECT_EQ(0U, statistics.tags.count("late"));
+  EXPECT_EQ(1U, statistics.tags.count("(other)"));
+
+  // After a reset, the old tags are gone and new ones get counters of their own again.
+  ResetLogStatistics();
+  LogMessage::LogLine(nullptr, 0, WARNING, "late", "xy");
+  statistics = GetLogStatistics();
+  ASSERT_EQ(1U, statistics.tags.size());
+  EXPECT_EQ(1U, statistics.tags.count("late"));
+  EXPECT_EQ(1U, statistics.tags.begin()->second.emitted);
+  EXPECT_EQ(2U, statistics.tags.begin()->second.bytes);
+}
+
+TEST(logging, ResetLogStatistics_while_logging) {
+  using namespace android::base;
+  LogFunction old_logger = SetLogger([](LogId, LogSeverity, const char*, const char*, unsigned int,
+                                        const char*) {});
+  SetLogStatisticsEnabled(true);
+  auto guard = make_scope_guard([&] {
+    SetLogStatisticsEnabled(false);
+    ResetLogStatistics();
+    SetLogger(std::move(old_logger));
+  });
+
+  // Threads that were counting a tag when the statistics were reset mustn't count into whatever
+  // tag is seen next.
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      while (!stop.load()) LogMessage::LogLine(nullptr, 0, WARNING, "busy", "x");
+    });
+  }
+  for (int i = 0; i < 1000; ++i) {
+    ResetLogStatistics();
+    LogMessage::LogLine(nullptr, 0, WARNING, "quiet", "xy");
+    LogStatistics statistics = GetLogStatistics();
+    ASSERT_EQ(1U, statistics.tags.count("quiet")) << i;
+    ASSERT_EQ(1U, statistics.tags["quiet"].emitted) << i;
+    ASSERT_EQ(2U, statistics.tags["quiet"].bytes) << i;
+    std::this_thread::yield();
+  }
+  stop = true;
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(logging, SetLogStatisticsDumpInterval) {
+  using namespace android::base;
+  std::mutex lock;
+  std::condition_variable cv;
+  int dumps = 0;
+  SetLogStatisticsDumpInterval(std::chrono::milliseconds(10), [&](const LogStatistics&) {
+    std::lock_guard<std::mutex> guard(lock);
+    ++dumps;
+    cv.notify_all();
+  });
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(10), [&] { return dumps >= 2; }));
+  }
+  SetLogStatisticsDumpInterval(std::chrono::milliseconds::zero());
+  int dumps_after_stop = dumps;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(dumps_after_stop, dumps);
+}
+
+TEST(logging, reconfigure_while_logging) {
+  using namespace android::base;
+  LogFunction old_logger = SetLogger([](LogId, LogSeverity, const char*, const char*, unsigned int,
+                                        const char*) {});
+  LogSeverity old_severity = GetMinimumLogSeverity();
+  auto guard = make_scope_guard([&] {
+    SetLogger(std::move(old_logger));
+    SetMinimumLogSeverity(old_severity);
+    ClearTagMinimumLogSeverities();
+    SetDefaultTag("");
+  });
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> logged{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      while (!stop.load()) {
+        LOG(WARNING) << "message";
+        LogMessage::LogLine(nullptr, 0, WARNING, nullptr, "default tag");
+      }
+    });
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    // Each logger owns some state, so using one after it's freed is caught by the sanitizers.
+    auto count = std::make_shared<std::atomic<uint64_t>>(0);
+    SetLogger([count, &logged](LogId, LogSeverity, const char*, const char*, unsigned int,
+                               const char*) {
+      count->fetch_add(1);
+      logged.fetch_add(1);
+    });
+    SetDefaultTag("tag" + std::to_string(i));
+    SetMinimumLogSeverity(i % 2 == 0 ? VERBOSE : WARNING);
+    SetTagMinimumLogSeverity("tag" + std::to_string(i % 10), i % 2 == 0 ? VERBOSE : ERROR);
+  }
+  // On a single CPU, the loop above can finish before the threads have run at all.  The final
+  // configuration still logs their WARNINGs, so give them a chance to.
+  for (int i = 0; i < 1000 && logged.load() == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  stop = true;
+  for (auto& thread : threads) thread.join();
+  EXPECT_NE(0U, logged.load());
+}
@@ -16,6 +16,15 @@
 
 #include "android-base/parsedouble.h"
 
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 TEST(parsedouble, double_smoke) {
@@ -65,3 +74,144 @@ TEST(parsedouble, float_smoke) {
   ASSERT_FALSE(android::base::ParseFloat("3.0", nullptr, -1.0, 2.0));
   ASSERT_TRUE(android::base::ParseFloat("1.0", nullptr, 0.0, 2.0));
 }
+
+TEST(parsedouble, string_view) {
+  // No NUL terminator is needed.
+  std::string_view numbers = "1.5 -2.25e1";
+  double d;
+  ASSERT_TRUE(android::base::ParseDouble(numbers.substr(0, 3), &d));
+  ASSERT_DOUBLE_EQ(1.5, d);
+  ASSERT_TRUE(android::base::ParseDouble(numbers.substr(4), &d));
+  ASSERT_DOUBLE_EQ(-22.5, d);
+  float f;
+  ASSERT_TRUE(android::base::ParseFloat(numbers.substr(0, 1), &f));
+  ASSERT_FLOAT_EQ(1.0, f);
+  ASSERT_FALSE(android::base::ParseFloat(numbers.substr(0, 4), &f));
+  ASSERT_EQ(EINVAL, errno);
+}
+
+TEST(parsedouble, strtod_syntax) {
+  double d;
+  ASSERT_TRUE(android::base::ParseDouble(" \t+1.5", &d));
+  ASSERT_DOUBLE_EQ(1.5, d);
+  ASSERT_TRUE(android::base::ParseDouble("0x1.8p1", &d));
+  ASSERT_DOUBLE_EQ(3.0, d);
+  ASSERT_TRUE(android::base::ParseDouble("-0X10", &d));
+  ASSERT_DOUBLE_EQ(-16.0, d);
+  ASSERT_TRUE(android::base::ParseDouble(".5", &d));
+  ASSERT_DOUBLE_EQ(0.5, d);
+  ASSERT_TRUE(android::base::ParseDouble("5.", &d));
+  ASSERT_DOUBLE_EQ(5.0, d);
+  // Infinities are beyond the default bounds.
+  constexpr double kInfinity = std::numeric_limits<double>::infinity();
+  ASSERT_FALSE(android::base::ParseDouble("inf", &d));
+  ASSERT_TRUE(android::base::ParseDouble("-inf", &d, -kInfinity));
+  ASSERT_TRUE(isinf(d) && d < 0);
+  ASSERT_TRUE(android::base::ParseDouble("Infinity", &d, 0.0, kInfinity));
+  ASSERT_TRUE(isinf(d) && d > 0);
+  ASSERT_TRUE(android::base::ParseDouble("nan", &d));
+  ASSERT_TRUE(isnan(d));
+
+  for (const char* s :
+       {"--1", "+-1", "- 1", "1 ", "0x", "0xp1", "0xinf", "0x-1", ".", "e1", "1e"}) {
+    errno = 0;
+    ASSERT_FALSE(android::base::ParseDouble(s, &d)) << s;
+    ASSERT_EQ(EINVAL, errno) << s;
+  }
+  for (const char* s : {"1e400", "-1e400"}) {
+    errno = 0;
+    ASSERT_FALSE(android::base::ParseDouble(s, &d)) << s;
+    ASSERT_EQ(ERANGE, errno) << s;
+  }
+  float f;
+  errno = 0;
+  ASSERT_FALSE(android::base::ParseFloat("1e39", &f));
+  ASSERT_EQ(ERANGE, errno);
+}
+
+TEST(parsedouble, ParseNumber) {
+  using android::base::ParseError;
+  using android::base::ParseNumber;
+
+  auto d = ParseNumber<double>(" 2.5");
+  ASSERT_TRUE(d);
+  EXPECT_DOUBLE_EQ(2.5, d.value);
+  EXPECT_EQ(4U, d.position);
+
+  d = ParseNumber<double>("2.5x");
+  EXPECT_EQ(ParseError::kInvalid, d.error);
+  EXPECT_EQ(3U, d.position);
+  EXPECT_EQ(0U, ParseNumber<double>("x").position);
+  EXPECT_EQ(2U, ParseNumber<double>(" -").position);
+  EXPECT_EQ(2U, ParseNumber<double>("0xz").position);
+
+  auto f = ParseNumber<float>("  1e39");
+  EXPECT_EQ(ParseError::kOutOfRange, f.error);
+  EXPECT_EQ(2U, f.position);
+  f = ParseNumber<float>(" 3", 0.0f, 2.0f);
+  EXPECT_EQ(ParseError::kOutOfRange, f.error);
+  EXPECT_EQ(1U, f.position);
+}
+
+TEST(parsedouble, matches_strtod) {
+  std::vector<std::string> inputs = {"0", "1", "0.1", "3.14159265358979323846",
+                                     "1e-5", "1E+5", "123456789012345678901234567890",
+                                     "2.2250738585072014e-308", "1.7976931348623157e308",
+                                     "0x1p-1022", "0x1.fffffffffffffp1023", "0xabc.defp4",
+                                     "4.9406564584124654e-324", "9007199254740993"};
+  for (const std::string& input : inputs) {
+    for (const std::string& s : {input, "-" + input, " +" + input}) {
+      double expected = strtod(s.c_str(), nullptr);
+      double d;
+      ASSERT_TRUE(android::base::ParseDouble(s, &d)) << s;
+      ASSERT_EQ(expected, d) << s;
+      float expected_f = strtof(s.c_str(), nullptr);
+      float f;
+      if (android::base::ParseFloat(s, &f)) {
+        ASSERT_EQ(expected_f, f) << s;
+      }
+    }
+  }
+}
+
+TEST(parsedouble, StrtodFloatingPoint) {
+  // The strtod() fallback for toolchains without a floating point std::from_chars only copies the
+  // number itself, so must stop where ConvertFloatingPoint does whatever follows it.
+  using android::base::ParseError;
+  using android::base::internal::ConvertFloatingPoint;
+  using android::base::internal::StrtodFloatingPoint;
+  std::string long_number = "1." + std::string(100, '2') + "e-3";
+  std::vector<std::string> numbers = {"0",         "1.5", "1e-5",     "1E+5",
+                                      "2.5e",      "1.7976931348623157e309",
+                                      "4.9406564584124654e-324", "inf", "infinity", "nan",
+                                      long_number, "x"};
+  std::vector<std::string> suffixes = {"", " 2.5", ":1", "kB", "\n" + std::string(1000, 'x')};
+  for (const std::string& number : numbers) {
+    for (const std::string& suffix : suffixes) {
+      std::string s = number + suffix;
+      double expected, actual;
+      size_t expected_end, actual_end;
+      ParseError expected_error = ConvertFloatingPoint(s, false, &expected, &expected_end);
+      ParseError error = StrtodFloatingPoint(s, false, &actual, &actual_end);
+      ASSERT_EQ(expected_error, error) << s;
+      if (error == ParseError::kInvalid) continue;
+      ASSERT_EQ(expected_end, actual_end) << s;
+      if (error == ParseError::kOk && !isnan(expected)) {
+        ASSERT_EQ(expected, actual) << s;
+      }
+    }
+  }
+
+  for (std::string hex : {"1p4", "ab.cp-2", "f", "g"}) {
+    for (const std::string& suffix : suffixes) {
+      std::string s = hex + suffix;
+      double expected, actual;
+      size_t expected_end, actual_end;
+      ParseError expected_error = ConvertFloatingPoint(s, true, &expected, &expected_end);
+      ASSERT_EQ(expected_error, StrtodFloatingPoint(s, true, &actual, &actual_end)) << s;
+      if (expected_error != ParseError::kOk) continue;
+      ASSERT_EQ(expected_end, actual_end) << s;
+      ASSERT_EQ(expected, actual) << s;
+    }
+  }
+}
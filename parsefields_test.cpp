@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/parsefields.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace android::base;
+
+TEST(parsefields, proc_pid_stat) {
+  std::string_view stat =
+      "1234 (system_server) S 567 1234 0 0 -1 1077952832 1521 0 0 0 2045 1311 0 0 18 -2 150 0 "
+      "219 14796455936 36781 18446744073709551615";
+  int pid;
+  std::string_view comm;
+  char state;
+  int ppid;
+  unsigned long long utime, stime;
+  auto result = ParseFields(stat, " ", &pid, &comm, nullptr, &ppid, nullptr, nullptr, nullptr,
+                            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &utime, &stime);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(1234, pid);
+  EXPECT_EQ("(system_server)", comm);
+  EXPECT_EQ(567, ppid);
+  EXPECT_EQ(2045U, utime);
+  EXPECT_EQ(1311U, stime);
+  // Where the rest of the fields begin.
+  EXPECT_EQ(stat.find(" 0 0 18"), result.value);
+  EXPECT_EQ(stat.size(), result.position);
+
+  // chars are numbers, not strings.
+  EXPECT_FALSE(ParseFields(stat, " ", nullptr, nullptr, &state));
+}
+
+TEST(parsefields, proc_meminfo) {
+  std::string_view meminfo = "MemTotal:        3809036 kB";
+  std::string name;
+  uint64_t kb;
+  std::string_view unit;
+  ASSERT_TRUE(ParseFields(meminfo, " ", &name, &kb, &unit));
+  EXPECT_EQ("MemTotal:", name);
+  EXPECT_EQ(3809036U, kb);
+  EXPECT_EQ("kB", unit);
+
+  ASSERT_TRUE(ParseFields(meminfo, ": ", nullptr, &kb));
+  EXPECT_EQ(3809036U, kb);
+}
+
+TEST(parsefields, doubles) {
+  std::string_view loadavg = "0.52 0.58 0.59 1/1064 12345\n";
+  double one, five;
+  float fifteen;
+  int running, total;
+  ASSERT_TRUE(ParseFields(loadavg, " /\n", &one, &five, &fifteen, &running, &total));
+  EXPECT_DOUBLE_EQ(0.52, one);
+  EXPECT_DOUBLE_EQ(0.58, five);
+  EXPECT_FLOAT_EQ(0.59f, fifteen);
+  EXPECT_EQ(1, running);
+  EXPECT_EQ(1064, total);
+
+  auto result = ParseFields("1.5 2.5.3", " ", &one, &five);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(7U, result.position);
+  EXPECT_DOUBLE_EQ(1.5, one);
+}
+
+TEST(parsefields, errors) {
+  int a = 0, b = 0;
+  uint8_t c = 0;
+
+  // Too few fields.
+  auto result = ParseFields(" 1  2 ", " ", &a, &b, &c);
+  EXPECT_FALSE(result);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(6U, result.position);
+  EXPECT_EQ(1, a);
+  EXPECT_EQ(2, b);
+  EXPECT_EQ(ParseError::kInvalid, ParseFields("", " ", &a).error);
+  EXPECT_EQ(ParseError::kInvalid, ParseFields("   ", " ", &a).error);
+
+  // Junk after a number.
+  result = ParseFields("1 2x 3", " ", &a, &b, &c);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(3U, result.position);
+  result = ParseFields("1 - 3", " ", &a, &b, &c);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(3U, result.position);
+
+  // Out of range, which junk takes precedence over as it does for ParseInt.
+  result = ParseFields("1 2 256", " ", &a, &b, &c);
+  EXPECT_EQ(ParseError::kOutOfRange, result.error);
+  EXPECT_EQ(4U, result.position);
+  result = ParseFields("1 2 256x", " ", &a, &b, &c);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(7U, result.position);
+  result = ParseFields("1 2 -1", " ", &a, &b, &c);
+  EXPECT_EQ(ParseError::kInvalid, result.error);
+  EXPECT_EQ(4U, result.position);
+
+  // Typed null pointers still have their fields checked.
+  EXPECT_TRUE(ParseFields("1 2", " ", static_cast<int*>(nullptr), &b));
+  EXPECT_FALSE(ParseFields("x 2", " ", static_cast<int*>(nullptr), &b));
+  EXPECT_TRUE(ParseFields("x 2", " ", nullptr, &b));
+}
+
+// Parses `line` the long way round, as ParseFields should.
+template <typename T>
+static ParseResult<size_t> TokenizeAndParse(std::string_view line, std::string_view delimiters,
+                                            std::vector<T>* values, size_t count) {
+  std::vector<std::string_view> fields = TokenizeToViews(line, delimiters);
+  for (size_t i = 0; i < count; ++i) {
+    if (i == fields.size()) {
+      return internal::ParseFailure<size_t>(ParseError::kInvalid, line.size());
+    }
+    ParseResult<T> result = ParseNumber<T>(fields[i]);
+    size_t offset = fields[i].data() - line.data();
+    if (!result) return internal::ParseFailure<size_t>(result.error, offset + result.position);
+    values->push_back(result.value);
+  }
+  return {0, ParseError::kOk, line.size()};
+}
+
+template <typename T>
+static void ExpectMatchesTokenizeAndParse(std::string_view line, std::string_view delimiters) {
+  std::vector<T> expected;
+  ParseResult<size_t> expected_result = TokenizeAndParse(line, delimiters, &expected, 3);
+  std::vector<T> actual(3);
+  ParseResult<size_t> result = ParseFields(line, delimiters, &actual[0], &actual[1], &actual[2]);
+  std::string message = "\"" + std::string(line) + "\" at \"" + std::string(delimiters) + "\"";
+  ASSERT_EQ(expected_result.error, result.error) << message;
+  ASSERT_EQ(expected_result.position, result.position) << message;
+  if (result) {
+    actual.resize(expected.size());
+    ASSERT_EQ(expected, actual) << message;
+  }
+}
+
+TEST(parsefields, matches_TokenizeAndParse) {
+  // Every kind of field, and delimiters that are and aren't part of numbers.
+  std::vector<std::string> fields = {"0",   "-1",   "+2",  "0x1f", "0x",    "-",   "x",
+                                     "1e3", "1.5",  "-2.5", "inf", "1-2",   "1_0", "300",
+                                     "a1",  "-129", "\t7",  "8\t", "65536", ".",   "(1)",
+                                     "99999999999999999999"};
+  for (const char* delimiters : {" ", " \t", ":", "-", ".", "x", "1"}) {
+    for (const std::string& a : fields) {
+      for (const std::string& b : fields) {
+        for (const char* separator : {" ", "  ", ":", " \t ", "-", "."}) {
+          std::string line = a + separator + b + separator + "3";
+          ExpectMatchesTokenizeAndParse<int8_t>(line, delimiters);
+          ExpectMatchesTokenizeAndParse<int>(line, delimiters);
+          ExpectMatchesTokenizeAndParse<uint16_t>(line, delimiters);
+          ExpectMatchesTokenizeAndParse<double>(line, delimiters);
+        }
+      }
+    }
+  }
+}
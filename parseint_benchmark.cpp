@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/parseint.h"
+#include "android-base/parsedouble.h"
+#include "android-base/parsefields.h"
+#include "android-base/strings.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+// Numbers like those in /proc/<pid>/stat: pids, flags, jiffies and byte counts, from 1 to 20
+// digits long.
+static std::vector<std::string> ProcNumbers() {
+  std::vector<std::string> numbers;
+  unsigned long long value = 7;
+  for (int i = 0; i < 1000; ++i) {
+    numbers.push_back(std::to_string(value % (i % 2 == 0 ? 100000 : 10000000000000000000ULL)));
+    value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return numbers;
+}
+
+// What ParseUint used to do.
+static bool ParseUintStrtoull(const char* s, unsigned long long* out) {
+  while (isspace(*s)) s++;
+  if (s[0] == '-') {
+    errno = EINVAL;
+    return false;
+  }
+  int base = (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) ? 16 : 10;
+  errno = 0;
+  char* end;
+  unsigned long long result = strtoull(s, &end, base);
+  if (errno != 0) return false;
+  if (end == s || *end != '\0') {
+    errno = EINVAL;
+    return false;
+  }
+  *out = result;
+  return true;
+}
+
+static void BenchmarkParseUintStrtoull(benchmark::State& state) {
+  std::vector<std::string> numbers = ProcNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      unsigned long long value = 0;
+      benchmark::DoNotOptimize(ParseUintStrtoull(number.c_str(), &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkParseUintStrtoull);
+
+static void BenchmarkParseUint(benchmark::State& state) {
+  std::vector<std::string> numbers = ProcNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      unsigned long long value = 0;
+      benchmark::DoNotOptimize(android::base::ParseUint(number.c_str(), &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkParseUint);
+
+static void BenchmarkTryParseUint(benchmark::State& state) {
+  std::vector<std::string> numbers = ProcNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      unsigned long long value = 0;
+      benchmark::DoNotOptimize(android::base::TryParseUint(number, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkTryParseUint);
+
+static void BenchmarkParseIntStrtoll(benchmark::State& state) {
+  std::vector<std::string> numbers = ProcNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      errno = 0;
+      char* end;
+      benchmark::DoNotOptimize(strtoll(number.c_str(), &end, 10));
+      benchmark::DoNotOptimize(end);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkParseIntStrtoll);
+
+static void BenchmarkTryParseInt(benchmark::State& state) {
+  std::vector<std::string> numbers = ProcNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      long long value = 0;
+      benchmark::DoNotOptimize(android::base::TryParseInt(number, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkTryParseInt);
+
+// Numbers like those in /proc/loadavg and battery or thermal readings.
+static std::vector<std::string> DecimalNumbers() {
+  std::vector<std::string> numbers;
+  unsigned long long value = 7;
+  for (int i = 0; i < 1000; ++i) {
+    numbers.push_back(std::to_string(value % 100000 / 100.0).substr(0, 2 + i % 8));
+    value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return numbers;
+}
+
+// What ParseDouble used to do.
+static bool ParseDoubleStrtod(const char* s, double* out) {
+  errno = 0;
+  char* end;
+  double result = strtod(s, &end);
+  if (errno != 0 || s == end || *end != '\0') return false;
+  *out = result;
+  return true;
+}
+
+static void BenchmarkParseDoubleStrtod(benchmark::State& state) {
+  std::vector<std::string> numbers = DecimalNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      double value = 0;
+      benchmark::DoNotOptimize(ParseDoubleStrtod(number.c_str(), &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkParseDoubleStrtod);
+
+static void BenchmarkParseDouble(benchmark::State& state) {
+  std::vector<std::string> numbers = DecimalNumbers();
+  for (auto _ : state) {
+    for (const auto& number : numbers) {
+      double value = 0;
+      benchmark::DoNotOptimize(android::base::ParseDouble(number, &value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+BENCHMARK(BenchmarkParseDouble);
+
+// Lines like those in /proc/<pid>/stat, of which we want the pid, ppid, utime, stime, start time,
+// vsize and rss.
+static std::vector<std::string> ProcPidStatLines() {
+  std::vector<std::string> numbers = ProcNumbers();
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < 100; ++i) {
+    // The even-numbered numbers are small enough to be pids.
+    std::string line = numbers[i * 2] + " (comm) S " + numbers[i * 2 + 2];
+    for (size_t j = 0; j < 48; ++j) line += " " + numbers[(i * 48 + j) % numbers.size()];
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+static void BenchmarkProcPidStatSplitParseInt(benchmark::State& state) {
+  std::vector<std::string> lines = ProcPidStatLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) {
+      std::vector<std::string> fields = android::base::Split(line, " ");
+      int pid, ppid;
+      unsigned long long utime, stime, start_time, vsize, rss;
+      benchmark::DoNotOptimize(fields.size() >= 24 && android::base::ParseInt(fields[0], &pid) &&
+                               android::base::ParseInt(fields[3], &ppid) &&
+                               android::base::ParseUint(fields[13], &utime) &&
+                               android::base::ParseUint(fields[14], &stime) &&
+                               android::base::ParseUint(fields[21], &start_time) &&
+                               android::base::ParseUint(fields[22], &vsize) &&
+                               android::base::ParseUint(fields[23], &rss));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkProcPidStatSplitParseInt);
+
+static void BenchmarkProcPidStatParseFields(benchmark::State& state) {
+  std::vector<std::string> lines = ProcPidStatLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) {
+      int pid, ppid;
+      unsigned long long utime, stime, start_time, vsize, rss;
+      benchmark::DoNotOptimize(android::base::ParseFields(
+          line, " ", &pid, nullptr, nullptr, &ppid, nullptr, nullptr, nullptr, nullptr, nullptr,
+          nullptr, nullptr, nullptr, nullptr, &utime, &stime, nullptr, nullptr, nullptr, nullptr,
+          nullptr, nullptr, &start_time, &vsize, &rss));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkProcPidStatParseFields);
+
+// Lines like those in /proc/meminfo.
+static std::vector<std::string> ProcMeminfoLines() {
+  std::vector<std::string> numbers = ProcNumbers();
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < 100; ++i) {
+    std::string name = "Field" + std::to_string(i) + ":";
+    std::string number = numbers[i * 2];
+    lines.push_back(name + std::string(24 - name.size() - number.size(), ' ') + number + " kB");
+  }
+  return lines;
+}
+
+static void BenchmarkProcMeminfoTokenizeParseUint(benchmark::State& state) {
+  std::vector<std::string> lines = ProcMeminfoLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) {
+      std::vector<std::string> fields = android::base::Tokenize(line, " ");
+      unsigned long long kb;
+      benchmark::DoNotOptimize(fields.size() >= 2 && android::base::ParseUint(fields[1], &kb));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkProcMeminfoTokenizeParseUint);
+
+static void BenchmarkProcMeminfoParseFields(benchmark::State& state) {
+  std::vector<std::string> lines = ProcMeminfoLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) {
+      std::string_view name;
+      unsigned long long kb;
+      benchmark::DoNotOptimize(android::base::ParseFields(line, " ", &name, &kb));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkProcMeminfoParseFields);
+
+// A line of `fields` floating point numbers, such as a row of sensor readings.
+static std::string FloatingPointLine(size_t fields) {
+  std::vector<std::string> numbers = DecimalNumbers();
+  std::string line;
+  for (size_t i = 0; i < fields; ++i) {
+    if (i != 0) line += ' ';
+    line += numbers[i % numbers.size()];
+  }
+  return line;
+}
+
+// Each field costs the same however much of the line follows it.
+static void BenchmarkFloatingPointLineParseFields(benchmark::State& state) {
+  std::string line = FloatingPointLine(state.range(0));
+  for (auto _ : state) {
+    std::string_view rest = line;
+    double value;
+    while (auto result = android::base::ParseFields(rest, " ", &value)) {
+      benchmark::DoNotOptimize(value);
+      rest.remove_prefix(result.value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BenchmarkFloatingPointLineParseFields)->Arg(8)->Arg(64)->Arg(512);
+
+// The same, as ParseFields scans each field on toolchains without a floating point
+// std::from_chars, which only copies the number itself for strtod().
+static void BenchmarkFloatingPointLineStrtodFallback(benchmark::State& state) {
+  std::string line = FloatingPointLine(state.range(0));
+  for (auto _ : state) {
+    std::string_view rest = line;
+    double value;
+    size_t end;
+    while (android::base::internal::StrtodFloatingPoint(rest, false, &value, &end) ==
+           android::base::ParseError::kOk) {
+      benchmark::DoNotOptimize(value);
+      rest.remove_prefix(std::min(end + 1, rest.size()));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BenchmarkFloatingPointLineStrtodFallback)->Arg(8)->Arg(64)->Arg(512);
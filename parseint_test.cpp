@@ -17,6 +17,13 @@
 #include "android-base/parseint.h"
 
 #include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -151,6 +158,69 @@ TEST(parseint, string) {
   ASSERT_EQ(123u, u);
 }
 
+TEST(parseint, string_view) {
+  // No NUL terminator is needed.
+  std::string_view numbers = "-123 456 7k";
+  int i = 0;
+  ASSERT_TRUE(android::base::ParseInt(numbers.substr(0, 4), &i));
+  ASSERT_EQ(-123, i);
+  unsigned int u = 0u;
+  ASSERT_TRUE(android::base::ParseUint(numbers.substr(5, 3), &u));
+  ASSERT_EQ(456u, u);
+  ASSERT_TRUE(android::base::ParseByteCount(numbers.substr(9), &u));
+  ASSERT_EQ(7u * 1024, u);
+  ASSERT_FALSE(android::base::ParseInt(numbers.substr(0, 5), &i));
+  ASSERT_EQ(EINVAL, errno);
+
+  // Nor is a NUL the end of a std::string any more.
+  using namespace std::string_literals;
+  ASSERT_FALSE(android::base::ParseInt("123\0"s, &i));
+  ASSERT_EQ(-123, i);
+}
+
+TEST(parseint, ParseNumber) {
+  using android::base::ParseError;
+  using android::base::ParseNumber;
+
+  auto i = ParseNumber<int>(" -42");
+  ASSERT_TRUE(i);
+  EXPECT_EQ(-42, i.value);
+  EXPECT_EQ(4U, i.position);
+  auto u = ParseNumber<uint16_t>("0x1f");
+  ASSERT_TRUE(u.ok());
+  EXPECT_EQ(0x1f, u.value);
+
+  // Failures say where the problem is.
+  i = ParseNumber<int>("12x4");
+  EXPECT_FALSE(i);
+  EXPECT_EQ(ParseError::kInvalid, i.error);
+  EXPECT_EQ(2U, i.position);
+  EXPECT_EQ(0, i.value);
+  EXPECT_EQ(0U, ParseNumber<int>("").position);
+  EXPECT_EQ(2U, ParseNumber<int>("  ").position);
+  EXPECT_EQ(3U, ParseNumber<int>("  -").position);
+  EXPECT_EQ(2U, ParseNumber<int>("0x").position);
+  EXPECT_EQ(0U, ParseNumber<int>("x1").position);
+  // A sign, where only an unsigned number will do.
+  u = ParseNumber<uint16_t>(" -1");
+  EXPECT_EQ(ParseError::kInvalid, u.error);
+  EXPECT_EQ(1U, u.position);
+
+  // Numbers out of range are reported at their start.
+  i = ParseNumber<int>("  99999999999999999999");
+  EXPECT_EQ(ParseError::kOutOfRange, i.error);
+  EXPECT_EQ(2U, i.position);
+  i = ParseNumber<int>(" 16", 0, 15);
+  EXPECT_EQ(ParseError::kOutOfRange, i.error);
+  EXPECT_EQ(1U, i.position);
+  u = ParseNumber<uint16_t>("65536");
+  EXPECT_EQ(ParseError::kOutOfRange, u.error);
+  EXPECT_EQ(0U, u.position);
+  u = ParseNumber<uint16_t>("1", 2);
+  EXPECT_EQ(ParseError::kOutOfRange, u.error);
+  EXPECT_TRUE(ParseNumber<uint16_t>("2", 2));
+}
+
 TEST(parseint, untouched_on_failure) {
   int i = 123;
   ASSERT_FALSE(android::base::ParseInt("456x", &i));
@@ -185,6 +255,18 @@ TEST(parseint, ParseByteCount) {
   ASSERT_EQ(4ULL * 1024 * 1024 * 1024 * 1024 * 1024 * 1024, i);
 }
 
+TEST(parseint, ParseByteCount_trailing_bytes_after_suffix) {
+  // Callers pass the likes of "16kB" from properties and config files.
+  uint64_t i = 0;
+  ASSERT_TRUE(android::base::ParseByteCount("16kB", &i));
+  ASSERT_EQ(16ULL * 1024, i);
+  ASSERT_TRUE(android::base::ParseByteCount("4KB", &i));
+  ASSERT_EQ(4ULL * 1024, i);
+  ASSERT_TRUE(android::base::ParseByteCount(std::string("2MiB"), &i));
+  ASSERT_EQ(2ULL * 1024 * 1024, i);
+  ASSERT_FALSE(android::base::ParseByteCount("16xB", &i));
+}
+
 TEST(parseint, ParseByteCount_invalid_suffix) {
   unsigned u;
   ASSERT_FALSE(android::base::ParseByteCount("1x", &u));
@@ -201,3 +283,129 @@ TEST(parseint, ParseByteCount_overflow) {
   ASSERT_EQ(65535U, u16);
   ASSERT_FALSE(android::base::ParseByteCount("65k", &u16));
 }
+
+TEST(parseint, TryParseInt) {
+  int i = 0;
+  errno = 123;
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseInt("-42", &i));
+  EXPECT_EQ(-42, i);
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseInt("42x", &i));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseInt("", &i));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseInt(" ", &i));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseInt("-", &i));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseInt("0x", &i));
+  EXPECT_EQ(android::base::ParseError::kOutOfRange, android::base::TryParseInt("16", &i, 0, 15));
+  EXPECT_EQ(android::base::ParseError::kOutOfRange,
+            android::base::TryParseInt("99999999999999999999", &i));
+  EXPECT_EQ(-42, i);
+  // errno is left alone.
+  EXPECT_EQ(123, errno);
+
+  // No NUL terminator is needed.
+  std::string_view numbers = "123 456";
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseInt(numbers.substr(0, 3), &i));
+  EXPECT_EQ(123, i);
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseInt(numbers.substr(4), &i));
+  EXPECT_EQ(456, i);
+}
+
+TEST(parseint, TryParseUint) {
+  uint64_t u = 0;
+  errno = 123;
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseUint("0xffffffffffffffff", &u));
+  EXPECT_EQ(UINT64_MAX, u);
+  EXPECT_EQ(android::base::ParseError::kOutOfRange,
+            android::base::TryParseUint("0x10000000000000000", &u));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseUint("-1", &u));
+  EXPECT_EQ(android::base::ParseError::kInvalid, android::base::TryParseUint("1k", &u));
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseByteCount("1k", &u));
+  EXPECT_EQ(1024U, u);
+  // Anything after the suffix is ignored, as it is by ParseByteCount.
+  EXPECT_EQ(android::base::ParseError::kOk, android::base::TryParseByteCount("2kb", &u));
+  EXPECT_EQ(2048U, u);
+  EXPECT_EQ(android::base::ParseError::kOutOfRange, android::base::TryParseByteCount("16e", &u));
+  EXPECT_EQ(123, errno);
+}
+
+TEST(parseint, limits) {
+  int64_t i;
+  ASSERT_TRUE(android::base::ParseInt("9223372036854775807", &i));
+  EXPECT_EQ(INT64_MAX, i);
+  ASSERT_TRUE(android::base::ParseInt("-9223372036854775808", &i));
+  EXPECT_EQ(INT64_MIN, i);
+  errno = 0;
+  EXPECT_FALSE(android::base::ParseInt("9223372036854775808", &i));
+  EXPECT_EQ(ERANGE, errno);
+  errno = 0;
+  EXPECT_FALSE(android::base::ParseInt("-9223372036854775809", &i));
+  EXPECT_EQ(ERANGE, errno);
+  // As with strtoll(), a number too large for any type is out of range even with junk after it.
+  errno = 0;
+  EXPECT_FALSE(android::base::ParseInt("9223372036854775808x", &i));
+  EXPECT_EQ(ERANGE, errno);
+
+  uint64_t u;
+  ASSERT_TRUE(android::base::ParseUint("18446744073709551615", &u));
+  EXPECT_EQ(UINT64_MAX, u);
+  ASSERT_TRUE(android::base::ParseUint("00000000000000000000000000018446744073709551615", &u));
+  EXPECT_EQ(UINT64_MAX, u);
+  errno = 0;
+  EXPECT_FALSE(android::base::ParseUint("18446744073709551616", &u));
+  EXPECT_EQ(ERANGE, errno);
+
+  int8_t i8;
+  errno = 0;
+  EXPECT_FALSE(android::base::ParseInt("128", &i8));
+  EXPECT_EQ(ERANGE, errno);
+  ASSERT_TRUE(android::base::ParseInt("-128", &i8));
+  EXPECT_EQ(INT8_MIN, i8);
+}
+
+TEST(parseint, matches_strtoll) {
+  // Every way of writing numbers of every length, and every way of getting them wrong.
+  std::vector<std::string> inputs = {"", " ", "+", "-", "0x", "0X", "+0x1", "-0x1", "0x-1", "x1",
+                                     " \t\n\v\f\r1", "1 ", "0", "-0", "+0", "00", "0xg", "1e3"};
+  std::string digits = "98765432109876543210987654321";
+  for (size_t size = 1; size <= digits.size(); ++size) {
+    for (const char* prefix : {"", "-", "+", "0x", "  ", "000"}) {
+      inputs.push_back(prefix + digits.substr(0, size));
+      inputs.push_back(prefix + digits.substr(digits.size() - size));
+      inputs.push_back(prefix + digits.substr(0, size) + "x");
+      inputs.push_back(prefix + digits.substr(0, size / 2) + ":" + digits.substr(0, size / 2));
+      inputs.push_back(prefix + std::string(size, '9'));
+      inputs.push_back(prefix + std::string(size, 'f'));
+    }
+  }
+
+  for (const std::string& input : inputs) {
+    const char* s = input.c_str();
+    size_t start = strspn(s, " \t\n\v\f\r");
+    int base = (s[start] == '0' && (s[start + 1] == 'x' || s[start + 1] == 'X')) ? 16 : 10;
+
+    char* end;
+    errno = 0;
+    long long expected = strtoll(s, &end, base);
+    int expected_errno = errno != 0 ? errno : (end == s || *end != '\0') ? EINVAL : 0;
+    long long i = 0;
+    errno = 0;
+    ASSERT_EQ(expected_errno == 0, android::base::ParseInt(s, &i)) << input;
+    ASSERT_EQ(expected_errno, errno) << input;
+    if (expected_errno == 0) {
+      ASSERT_EQ(expected, i) << input;
+    }
+
+    errno = 0;
+    unsigned long long expected_u = strtoull(s, &end, base);
+    expected_errno = s[start] == '-' ? EINVAL
+                     : errno != 0    ? errno
+                     : (end == s || *end != '\0') ? EINVAL
+                                                  : 0;
+    unsigned long long u = 0;
+    errno = 0;
+    ASSERT_EQ(expected_errno == 0, android::base::ParseUint(s, &u)) << input;
+    ASSERT_EQ(expected_errno, errno) << input;
+    if (expected_errno == 0) {
+      ASSERT_EQ(expected_u, u) << input;
+    }
+  }
+}
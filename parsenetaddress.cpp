@@ -49,10 +49,11 @@ bool ParseNetAddress(const std::string& address, std::string* host, int* port,
   } else if (colons <= 1) {
     // 1.2.3.4 or some.accidental.domain.com
     ipv6 = false;
-    std::vector<std::string> pieces = Split(address, ":");
-    *host = pieces[0];
-    if (pieces.size() > 1) {
-      port_str = pieces[1];
+    SplitView pieces(address, ":");
+    auto piece = pieces.begin();
+    *host = *piece;
+    if (++piece != pieces.end()) {
+      port_str = *piece;
       saw_port = true;
     }
   }
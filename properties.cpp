@@ -208,7 +208,7 @@ bool WaitForPropertyCreation(const std::string& key,
 }
 
 CachedProperty::CachedProperty(const char* property_name)
-    : property_name_(property_name),
+    : property_name_(StringPool::Global().Intern(property_name)),
       prop_info_(nullptr),
       cached_area_serial_(0),
       cached_property_serial_(0),
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <limits>
+#include <type_traits>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace base {
+
+// Epoch-based read-copy-update, for values that are read on every log message but only replaced
+// when logging is reconfigured.
+//
+// A reader holds an RcuReadLock while it uses a value read from an RcuPointer.  Taking one only
+// writes to a record owned by the calling thread, so readers never contend with each other or with
+// writers.  A writer replaces the pointer and retires the old value, which is deleted by a later
+// writer once every reader that could have seen it has released its lock.  Writers never wait for
+// readers, so a reader that never finishes (a logger that blocks, or a thread that didn't survive
+// fork()) only keeps old values alive; it can't deadlock anybody.
+namespace rcu_detail {
+
+// One per thread that has read anything, reused once the thread exits.
+struct Record {
+  // The epoch at which the thread's outermost RcuReadLock was taken, or 0 if it holds none.
+  std::atomic<uint64_t> active{0};
+  std::atomic<bool> in_use{false};
+  // Immutable once the record has been published.
+  Record* next = nullptr;
+  // Only used by the thread that owns the record.
+  size_t nesting = 0;
+};
+
+struct Retired {
+  void* value;
+  void (*deleter)(void*);
+  // Readers that started at this epoch or later can't have seen the value.
+  uint64_t epoch;
+  Retired* next;
+};
+
+class Domain {
+ public:
+  static Domain& Get() {
+    static auto& domain = *new Domain();
+    return domain;
+  }
+
+  uint64_t epoch() const { return epoch_.load(std::memory_order_seq_cst); }
+
+  Record* AcquireRecord() {
+    for (Record* record = records_.load(std::memory_order_seq_cst); record != nullptr;
+         record = record->next) {
+      bool expected = false;
+      if (!record->in_use.load(std::memory_order_relaxed) &&
+          record->in_use.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+        return record;
+      }
+    }
+    Record* record = new Record;
+    record->in_use.store(true, std::memory_order_relaxed);
+    Record* head = records_.load(std::memory_order_relaxed);
+    do {
+      record->next = head;
+    } while (!records_.compare_exchange_weak(head, record, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed));
+    return record;
+  }
+
+  void ReleaseRecord(Record* record) {
+    record->nesting = 0;
+    record->active.store(0, std::memory_order_release);
+    record->in_use.store(false, std::memory_order_release);
+  }
+
+  // Returns the calling thread's record, or null once the thread has started exiting.
+  Record* ThreadRecord() {
+    static thread_local bool destroyed = false;
+    if (UNLIKELY(destroyed)) return nullptr;
+
+    struct Holder {
+      Record* record = nullptr;
+      ~Holder() {
+        if (record != nullptr) Domain::Get().ReleaseRecord(record);
+        destroyed = true;
+      }
+    };
+    // The record has to be released when its thread exits, or every thread that ever logged would
+    // leave a record behind.
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+    static thread_local Holder holder;
+#pragma clang diagnostic pop
+    if (UNLIKELY(holder.record == nullptr)) holder.record = AcquireRecord();
+    return holder.record;
+  }
+
+  // Deletes `value` with `deleter` once no reader can be using it.
+  void Retire(void* value, void (*deleter)(void*)) {
+    // Bumping the epoch after the value was unpublished means that readers that start from here
+    // on can only see its replacement.
+    uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    Push(new Retired{value, deleter, epoch, nullptr});
+    Reclaim();
+  }
+
+ private:
+  Domain() = default;
+
+  void Push(Retired* retired) {
+    Retired* head = retired_.load(std::memory_order_relaxed);
+    do {
+      retired->next = head;
+    } while (!retired_.compare_exchange_weak(head, retired, std::memory_order_release,
+                                             std::memory_order_relaxed));
+  }
+
+  void Reclaim() {
+    Retired* list = retired_.exchange(nullptr, std::memory_order_acquire);
+    if (list == nullptr) return;
+
+    uint64_t oldest_active = std::numeric_limits<uint64_t>::max();
+    for (Record* record = records_.load(std::memory_order_seq_cst); record != nullptr;
+         record = record->next) {
+      uint64_t active = record->active.load(std::memory_order_seq_cst);
+      if (active != 0 && active < oldest_active) oldest_active = active;
+    }
+
+    while (list != nullptr) {
+      Retired* next = list->next;
+      if (list->epoch <= oldest_active) {
+        list->deleter(list->value);
+        delete list;
+      } else {
+        Push(list);
+      }
+      list = next;
+    }
+  }
+
+  // Records are never freed, so the list can be walked without a lock.
+  std::atomic<Record*> records_{nullptr};
+  // Starts at 1 because 0 marks an inactive record.
+  std::atomic<uint64_t> epoch_{1};
+  std::atomic<Retired*> retired_{nullptr};
+
+  DISALLOW_COPY_AND_ASSIGN(Domain);
+};
+
+}  // namespace rcu_detail
+
+// Keeps every value read from an RcuPointer while it's held alive.  Can be nested.
+class RcuReadLock {
+ public:
+  RcuReadLock() : record_(rcu_detail::Domain::Get().ThreadRecord()) {
+    if (UNLIKELY(record_ == nullptr)) {
+      // The thread is exiting and has lost its record, so borrow one just for this lock.
+      record_ = rcu_detail::Domain::Get().AcquireRecord();
+      owned_ = true;
+    }
+    if (record_->nesting++ == 0) {
+      record_->active.store(rcu_detail::Domain::Get().epoch(), std::memory_order_seq_cst);
+    }
+  }
+
+  ~RcuReadLock() {
+    if (--record_->nesting == 0) {
+      record_->active.store(0, std::memory_order_release);
+    }
+    if (UNLIKELY(owned_)) rcu_detail::Domain::Get().ReleaseRecord(record_);
+  }
+
+ private:
+  rcu_detail::Record* record_;
+  bool owned_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(RcuReadLock);
+};
+
+// A pointer to a heap-allocated value that can be replaced while other threads are reading it.
+template <typename T>
+class RcuPointer {
+ public:
+  constexpr explicit RcuPointer(T* value = nullptr) : value_(value) {}
+
+  // The result stays valid for as long as the caller holds an RcuReadLock.
+  T* Read() const { return value_.load(std::memory_order_seq_cst); }
+
+  // Publishes `value` and returns the old value, which the caller can keep using until it passes
+  // it to Retire().
+  T* Exchange(T* value) { return value_.exchange(value, std::memory_order_seq_cst); }
+
+  // Deletes a value returned by Exchange() once no reader can be using it.
+  static void Retire(T* value) {
+    if (value == nullptr) return;
+    rcu_detail::Domain::Get().Retire(const_cast<std::remove_const_t<T>*>(value),
+                                     [](void* p) { delete static_cast<T*>(p); });
+  }
+
+  void Replace(T* value) { Retire(Exchange(value)); }
+
+ private:
+  std::atomic<T*> value_;
+
+  DISALLOW_COPY_AND_ASSIGN(RcuPointer);
+};
+
+}  // namespace base
+}  // namespace android
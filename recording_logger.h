@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Loggers for the logging tests.
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "android-base/logging.h"
+
+// A logger that records what it's given, optionally stalling until released so that tests can
+// fill an AsyncLogger's queue.
+struct RecordingLogger {
+  void Log(android::base::LogSeverity severity, const char* file, const char* message) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !stalled; });
+    messages.emplace_back(severity, message);
+    files.emplace_back(file != nullptr ? file : "");
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stalled = false;
+    }
+    cv.notify_all();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.clear();
+    files.clear();
+  }
+
+  std::vector<std::pair<android::base::LogSeverity, std::string>> Messages() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return messages;
+  }
+
+  std::vector<std::string> Files() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return files;
+  }
+
+  android::base::LogFunction Function() {
+    return [this](android::base::LogId, android::base::LogSeverity severity, const char*,
+                  const char* file, unsigned int,
+                  const char* message) { Log(severity, file, message); };
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stalled = false;
+  std::vector<std::pair<android::base::LogSeverity, std::string>> messages;
+  std::vector<std::string> files;
+};
+
+// Makes a RecordingLogger the logger while it's in scope.
+class ScopedRecordingLogger {
+ public:
+  ScopedRecordingLogger() : old_logger_(android::base::SetLogger(recorder_.Function())) {}
+
+  ~ScopedRecordingLogger() { android::base::SetLogger(std::move(old_logger_)); }
+
+  std::vector<std::string> Messages() {
+    std::vector<std::string> result;
+    for (auto& [severity, message] : recorder_.Messages()) result.push_back(std::move(message));
+    return result;
+  }
+
+  std::vector<android::base::LogSeverity> Severities() {
+    std::vector<android::base::LogSeverity> result;
+    for (const auto& [severity, message] : recorder_.Messages()) result.push_back(severity);
+    return result;
+  }
+
+  std::vector<std::string> Files() { return recorder_.Files(); }
+
+ private:
+  RecordingLogger recorder_;
+  android::base::LogFunction old_logger_;
+};
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/string_pool.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace base {
+
+using internal::InternedEntry;
+
+// Strings are allocated from chunks of at least this many bytes.
+static constexpr size_t kChunkSize = 4096;
+
+static constexpr size_t EntrySize(size_t size) {
+  constexpr size_t kAlignment = alignof(InternedEntry);
+  return (sizeof(InternedEntry) + size + 1 + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// A shard is an open-addressed hash table of entries, at most half full, and the arena they live
+// in.  Which shard a string belongs to is decided by the top bits of its hash, and where it goes
+// in the shard's table by the bottom bits, so the two are independent.
+struct StringPool::Shard {
+  std::mutex lock;
+  // Guarded by lock.
+  std::vector<const InternedEntry*> table = std::vector<const InternedEntry*>(16);
+  size_t size = 0;
+  std::vector<std::unique_ptr<char[]>> chunks;
+  char* next = nullptr;
+  size_t available = 0;
+  size_t allocated = 0;
+
+  // Must be called with lock held.  Returns the slot that holds `s`, or the empty slot it
+  // belongs in.
+  const InternedEntry** Slot(std::string_view s, size_t hash) {
+    size_t mask = table.size() - 1;
+    for (size_t i = hash;; ++i) {
+      const InternedEntry*& entry = table[i & mask];
+      if (entry == nullptr) return &entry;
+      if (entry->hash == hash && entry->size == s.size() &&
+          memcmp(entry + 1, s.data(), s.size()) == 0) {
+        return &entry;
+      }
+    }
+  }
+
+  // Must be called with lock held.
+  const InternedEntry* Add(std::string_view s, size_t hash) {
+    size_t entry_size = EntrySize(s.size());
+    if (entry_size > available) {
+      size_t chunk_size = std::max(kChunkSize, entry_size);
+      chunks.emplace_back(new char[chunk_size]);
+      next = chunks.back().get();
+      available = chunk_size;
+      allocated += chunk_size;
+    }
+    InternedEntry* entry = reinterpret_cast<InternedEntry*>(next);
+    next += entry_size;
+    available -= entry_size;
+
+    entry->size = s.size();
+    entry->hash = hash;
+    char* data = reinterpret_cast<char*>(entry + 1);
+    memcpy(data, s.data(), s.size());
+    data[s.size()] = '\0';
+    return entry;
+  }
+
+  // Must be called with lock held.
+  void Grow() {
+    std::vector<const InternedEntry*> old(table.size() * 2);
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for (const InternedEntry* entry : old) {
+      if (entry == nullptr) continue;
+      size_t i = entry->hash;
+      while (table[i & mask] != nullptr) ++i;
+      table[i & mask] = entry;
+    }
+  }
+};
+
+StringPool::StringPool() : shards_(new Shard[kShardCount]) {}
+
+StringPool::~StringPool() = default;
+
+InternedString StringPool::Intern(std::string_view s) {
+  if (s.empty()) return InternedString();
+
+  size_t hash = std::hash<std::string_view>()(s);
+  Shard& shard = shards_[hash >> (sizeof(hash) * 8 - kShardBits)];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  const InternedEntry** slot = shard.Slot(s, hash);
+  if (*slot != nullptr) return InternedString(*slot);
+
+  const InternedEntry* entry = shard.Add(s, hash);
+  *slot = entry;
+  if (++shard.size * 2 > shard.table.size()) shard.Grow();
+  return InternedString(entry);
+}
+
+std::optional<InternedString> StringPool::Find(std::string_view s) const {
+  if (s.empty()) return InternedString();
+
+  size_t hash = std::hash<std::string_view>()(s);
+  Shard& shard = shards_[hash >> (sizeof(hash) * 8 - kShardBits)];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  const InternedEntry* entry = *shard.Slot(s, hash);
+  if (entry == nullptr) return std::nullopt;
+  return InternedString(entry);
+}
+
+size_t StringPool::size() const {
+  size_t result = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    std::lock_guard<std::mutex> lock(shards_[i].lock);
+    result += shards_[i].size;
+  }
+  return result;
+}
+
+size_t StringPool::memory_usage() const {
+  size_t result = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    std::lock_guard<std::mutex> lock(shards_[i].lock);
+    result += shards_[i].allocated + shards_[i].table.size() * sizeof(shards_[i].table[0]);
+  }
+  return result;
+}
+
+StringPool& StringPool::Global() {
+  static auto& pool = *new StringPool();
+  return pool;
+}
+
+}  // namespace base
+}  // namespace android
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/string_pool.h"
+
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace android::base;
+
+TEST(string_pool, Intern) {
+  StringPool pool;
+  std::string tag = "ActivityManager";
+  InternedString a = pool.Intern(tag);
+  InternedString b = pool.Intern(std::string("Activity") + "Manager");
+  InternedString c = pool.Intern("PackageManager");
+
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  // The pool has its own copy.
+  EXPECT_NE(tag.data(), a.data());
+  EXPECT_EQ(a.data(), b.data());
+  EXPECT_EQ("ActivityManager", a.view());
+  EXPECT_EQ(15U, a.size());
+  EXPECT_STREQ("ActivityManager", a.c_str());
+  EXPECT_EQ(std::hash<std::string_view>()("ActivityManager"), a.content_hash());
+  EXPECT_EQ(2U, pool.size());
+}
+
+TEST(string_pool, empty) {
+  StringPool pool;
+  InternedString empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(0U, empty.size());
+  EXPECT_STREQ("", empty.c_str());
+  EXPECT_EQ(empty, pool.Intern(""));
+  EXPECT_EQ(empty, StringPool::Global().Intern(""));
+  EXPECT_EQ(std::hash<std::string_view>()(""), empty.content_hash());
+  EXPECT_EQ(0U, pool.size());
+}
+
+TEST(string_pool, embedded_nul) {
+  using namespace std::string_literals;
+  StringPool pool;
+  InternedString a = pool.Intern("a\0b"s);
+  InternedString b = pool.Intern("a\0c"s);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(3U, a.size());
+  EXPECT_EQ("a\0b"s, a.view());
+}
+
+TEST(string_pool, Find) {
+  StringPool pool;
+  EXPECT_FALSE(pool.Find("tag").has_value());
+  EXPECT_EQ(0U, pool.size());
+  InternedString tag = pool.Intern("tag");
+  ASSERT_TRUE(pool.Find("tag").has_value());
+  EXPECT_EQ(tag, *pool.Find("tag"));
+  EXPECT_EQ(InternedString(), *pool.Find(""));
+}
+
+TEST(string_pool, different_pools) {
+  StringPool pool1;
+  StringPool pool2;
+  EXPECT_NE(pool1.Intern("tag"), pool2.Intern("tag"));
+  EXPECT_EQ(pool1.Intern("tag").view(), pool2.Intern("tag").view());
+}
+
+TEST(string_pool, many) {
+  // Enough strings to grow every shard's table several times, and strings longer than an arena
+  // chunk.
+  StringPool pool;
+  std::vector<InternedString> interned;
+  for (int i = 0; i < 10000; ++i) {
+    interned.push_back(pool.Intern("tag" + std::to_string(i)));
+  }
+  interned.push_back(pool.Intern(std::string(10000, 'x')));
+  EXPECT_EQ(10001U, pool.size());
+  EXPECT_GE(pool.memory_usage(), 10000U * sizeof("tagNNNN"));
+
+  for (int i = 0; i < 10000; ++i) {
+    std::string tag = "tag" + std::to_string(i);
+    ASSERT_EQ(interned[i], pool.Intern(tag)) << tag;
+    ASSERT_EQ(tag, interned[i].view());
+  }
+  EXPECT_EQ(std::string(10000, 'x'), pool.Intern(std::string(10000, 'x')).view());
+  EXPECT_EQ(10001U, pool.size());
+
+  std::unordered_set<InternedString> set(interned.begin(), interned.end());
+  EXPECT_EQ(10001U, set.size());
+}
+
+TEST(string_pool, threads) {
+  StringPool pool;
+  std::vector<std::vector<InternedString>> results(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&pool, &result = results[i]] {
+      for (int j = 0; j < 1000; ++j) {
+        result.push_back(pool.Intern("tag" + std::to_string(j)));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(1000U, pool.size());
+  for (size_t i = 1; i < results.size(); ++i) {
+    EXPECT_EQ(results[0], results[i]);
+  }
+}
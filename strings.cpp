@@ -21,11 +21,27 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
-#ifndef strncasecmp
-#define strncasecmp _strnicmp
+#if defined(__AVX2__)
+#define LIBBASE_STRINGS_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIBBASE_STRINGS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LIBBASE_STRINGS_NEON 1
+#include <arm_neon.h>
+#endif
+#if defined(LIBBASE_STRINGS_AVX2) || defined(LIBBASE_STRINGS_SSE2) || defined(LIBBASE_STRINGS_NEON)
+#define LIBBASE_STRINGS_VECTOR 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
 #endif
 
 // Wraps the posix version of strerror_r to make it available in translation units
@@ -38,38 +54,278 @@ namespace base {
 #define CHECK_NE(a, b) \
   if ((a) == (b)) abort();
 
-std::vector<std::string> Split(const std::string& s,
-                               const std::string& delimiters) {
-  CHECK_NE(delimiters.size(), 0U);
+namespace internal {
 
-  std::vector<std::string> result;
+DelimiterSet::DelimiterSet(std::string_view delimiters) {
+  for (char ch : delimiters) {
+    if (Contains(ch)) continue;
+    unsigned char byte = static_cast<unsigned char>(ch);
+    bits_[byte / 64] |= uint64_t(1) << (byte % 64);
+    if (count_ < kMaxVectorDelimiters) delimiters_[count_] = ch;
+    ++count_;
+  }
+}
+
+[[maybe_unused]] static inline size_t CountTrailingZeros(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return index;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
 
-  size_t base = 0;
-  size_t found;
-  while (true) {
-    found = s.find_first_of(delimiters, base);
-    result.push_back(s.substr(base, found - base));
-    if (found == s.npos) break;
-    base = found + 1;
+// Compares a vector's worth of bytes with each of a small set of delimiters at once, returning a
+// mask with bit i set if byte i is one of them.
+#if defined(LIBBASE_STRINGS_AVX2)
+class VectorMatcher {
+ public:
+  static constexpr size_t kWidth = 32;
+  static constexpr uint64_t kAll = 0xffffffff;
+
+  VectorMatcher(const char* delimiters, size_t count) : count_(count) {
+    for (size_t i = 0; i < count; ++i) sets_[i] = _mm256_set1_epi8(delimiters[i]);
+  }
+
+  uint64_t Match(const char* p) const {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i matches = _mm256_setzero_si256();
+    for (size_t i = 0; i < count_; ++i) {
+      matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, sets_[i]));
+    }
+    return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
   }
 
+ private:
+  __m256i sets_[DelimiterSet::kMaxVectorDelimiters];
+  size_t count_;
+};
+#elif defined(LIBBASE_STRINGS_SSE2)
+class VectorMatcher {
+ public:
+  static constexpr size_t kWidth = 16;
+  static constexpr uint64_t kAll = 0xffff;
+
+  VectorMatcher(const char* delimiters, size_t count) : count_(count) {
+    for (size_t i = 0; i < count; ++i) sets_[i] = _mm_set1_epi8(delimiters[i]);
+  }
+
+  uint64_t Match(const char* p) const {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i matches = _mm_setzero_si128();
+    for (size_t i = 0; i < count_; ++i) {
+      matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, sets_[i]));
+    }
+    return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+  }
+
+ private:
+  __m128i sets_[DelimiterSet::kMaxVectorDelimiters];
+  size_t count_;
+};
+#elif defined(LIBBASE_STRINGS_NEON)
+// NEON has no movemask: keep one bit per byte, then add up each half.
+static inline uint64_t MoveMask(uint8x16_t v) {
+  static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  uint8x16_t bits = vandq_u8(v, vld1q_u8(kBits));
+  return vaddv_u8(vget_low_u8(bits)) | (uint64_t(vaddv_u8(vget_high_u8(bits))) << 8);
+}
+
+class VectorMatcher {
+ public:
+  static constexpr size_t kWidth = 16;
+  static constexpr uint64_t kAll = 0xffff;
+
+  VectorMatcher(const char* delimiters, size_t count) : count_(count) {
+    for (size_t i = 0; i < count; ++i) sets_[i] = vdupq_n_u8(static_cast<uint8_t>(delimiters[i]));
+  }
+
+  uint64_t Match(const char* p) const {
+    uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t matches = vdupq_n_u8(0);
+    for (size_t i = 0; i < count_; ++i) {
+      matches = vorrq_u8(matches, vceqq_u8(chunk, sets_[i]));
+    }
+    return MoveMask(matches);
+  }
+
+ private:
+  uint8x16_t sets_[DelimiterSet::kMaxVectorDelimiters];
+  size_t count_;
+};
+#endif
+
+// Case-folds a vector's worth of bytes, lowering the ASCII letters and leaving every other byte
+// alone, and compares them.
+#if defined(LIBBASE_STRINGS_AVX2)
+struct AsciiVector {
+  using Vector = __m256i;
+  static constexpr size_t kWidth = 32;
+  static constexpr uint64_t kAll = 0xffffffff;
+
+  static Vector Broadcast(char ch) { return _mm256_set1_epi8(ch); }
+
+  static Vector LoadLower(const char* p) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    // There's no unsigned byte compare, so move 'A'..'Z' to the bottom of the signed range.
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8(static_cast<char>(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 + 26)), shifted);
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+  }
+
+  static uint64_t Equal(Vector lhs, Vector rhs) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)));
+  }
+};
+#elif defined(LIBBASE_STRINGS_SSE2)
+struct AsciiVector {
+  using Vector = __m128i;
+  static constexpr size_t kWidth = 16;
+  static constexpr uint64_t kAll = 0xffff;
+
+  static Vector Broadcast(char ch) { return _mm_set1_epi8(ch); }
+
+  static Vector LoadLower(const char* p) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // There's no unsigned byte compare, so move 'A'..'Z' to the bottom of the signed range.
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + 26)));
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+  }
+
+  static uint64_t Equal(Vector lhs, Vector rhs) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)));
+  }
+};
+#elif defined(LIBBASE_STRINGS_NEON)
+struct AsciiVector {
+  using Vector = uint8x16_t;
+  static constexpr size_t kWidth = 16;
+  static constexpr uint64_t kAll = 0xffff;
+
+  static Vector Broadcast(char ch) { return vdupq_n_u8(static_cast<uint8_t>(ch)); }
+
+  static Vector LoadLower(const char* p) {
+    uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t upper = vcltq_u8(vsubq_u8(x, vdupq_n_u8('A')), vdupq_n_u8(26));
+    return vorrq_u8(x, vandq_u8(upper, vdupq_n_u8(0x20)));
+  }
+
+  static uint64_t Equal(Vector lhs, Vector rhs) { return MoveMask(vceqq_u8(lhs, rhs)); }
+};
+#endif
+
+template <bool kMatch, typename F>
+void DelimiterSet::Scan(std::string_view s, size_t pos, const F& on_match) const {
+  const char* data = s.data();
+  size_t size = s.size();
+#if defined(LIBBASE_STRINGS_VECTOR)
+  if (count_ <= kMaxVectorDelimiters && pos + VectorMatcher::kWidth <= size) {
+    constexpr size_t kWidth = VectorMatcher::kWidth;
+    VectorMatcher matcher(delimiters_, count_);
+    while (pos + kWidth <= size) {
+      uint64_t mask = matcher.Match(data + pos);
+      if (!kMatch) mask = ~mask & VectorMatcher::kAll;
+      size_t chunk = pos;
+      pos += kWidth;
+      while (mask != 0) {
+        size_t next = on_match(chunk + CountTrailingZeros(mask));
+        if (next == std::string_view::npos) return;
+        if (next >= chunk + kWidth) {
+          pos = next;
+          break;
+        }
+        mask &= ~uint64_t(0) << (next - chunk);
+      }
+    }
+  }
+#endif
+  while (pos < size) {
+    if (Contains(data[pos]) == kMatch) {
+      pos = on_match(pos);
+      if (pos == std::string_view::npos) return;
+    } else {
+      ++pos;
+    }
+  }
+}
+
+size_t DelimiterSet::Find(std::string_view s, size_t pos) const {
+  if (pos >= s.size() || count_ == 0) return std::string_view::npos;
+  if (count_ == 1) {
+    // libc's memchr is already as fast as it gets.
+    const void* found = memchr(s.data() + pos, delimiters_[0], s.size() - pos);
+    return found != nullptr ? static_cast<const char*>(found) - s.data() : std::string_view::npos;
+  }
+  size_t result = std::string_view::npos;
+  Scan<true>(s, pos, [&result](size_t i) {
+    result = i;
+    return std::string_view::npos;
+  });
   return result;
 }
 
-std::vector<std::string> Tokenize(const std::string& s, const std::string& delimiters) {
+size_t DelimiterSet::FindNot(std::string_view s, size_t pos) const {
+  if (pos >= s.size()) return std::string_view::npos;
+  // Runs of delimiters are usually short, so check the first byte before setting up vectors.
+  if (!Contains(s[pos])) return pos;
+  size_t result = std::string_view::npos;
+  Scan<false>(s, pos + 1, [&result](size_t i) {
+    result = i;
+    return std::string_view::npos;
+  });
+  return result;
+}
+
+void DelimiterSet::FindEach(std::string_view s, size_t pos,
+                            function_ref<size_t(size_t)> on_match) const {
+  Scan<true>(s, pos, on_match);
+}
+
+}  // namespace internal
+
+// Calls emit(piece) for each piece of `s` between delimiters; if `skip_empty`, only for the
+// non-empty ones.
+template <typename F>
+static void SplitWith(std::string_view s, std::string_view delimiters, bool skip_empty,
+                      const F& emit) {
   CHECK_NE(delimiters.size(), 0U);
+  SplitView pieces(s, delimiters);
+  if (skip_empty) pieces.SkipEmpty();
+  for (std::string_view piece : pieces) emit(piece);
+}
 
+std::vector<std::string> Split(const std::string& s,
+                               const std::string& delimiters) {
   std::vector<std::string> result;
-  size_t end = 0;
+  SplitWith(s, delimiters, false, [&result](std::string_view piece) {
+    result.emplace_back(piece);
+  });
+  return result;
+}
 
-  while (true) {
-    size_t base = s.find_first_not_of(delimiters, end);
-    if (base == s.npos) {
-      break;
-    }
-    end = s.find_first_of(delimiters, base);
-    result.push_back(s.substr(base, end - base));
-  }
+std::vector<std::string> Tokenize(const std::string& s, const std::string& delimiters) {
+  std::vector<std::string> result;
+  SplitWith(s, delimiters, true, [&result](std::string_view piece) {
+    result.emplace_back(piece);
+  });
+  return result;
+}
+
+std::vector<std::string_view> SplitToViews(std::string_view s, std::string_view delimiters) {
+  std::vector<std::string_view> result;
+  SplitWith(s, delimiters, false, [&result](std::string_view piece) {
+    result.push_back(piece);
+  });
+  return result;
+}
+
+std::vector<std::string_view> TokenizeToViews(std::string_view s, std::string_view delimiters) {
+  std::vector<std::string_view> result;
+  SplitWith(s, delimiters, true, [&result](std::string_view piece) {
+    result.push_back(piece);
+  });
   return result;
 }
 
@@ -85,6 +341,13 @@ template std::string Trim(const std::string&&);
 template std::string Trim(std::string_view&);
 template std::string Trim(std::string_view&&);
 
+void TrimInPlace(std::string* s) {
+  std::string_view trimmed = TrimView(*s);
+  size_t start = trimmed.data() - s->data();
+  s->erase(start + trimmed.size());
+  s->erase(0, start);
+}
+
 // These cases are probably the norm, so we mark them extern in the header to
 // aid compile time and binary size.
 template std::string Join(const std::vector<std::string>&, char);
@@ -100,8 +363,49 @@ bool StartsWith(std::string_view s, char prefix) {
   return !s.empty() && s.front() == prefix;
 }
 
+static constexpr char AsciiToLower(char ch) {
+  return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+// Loads eight bytes and lowers the ASCII letters among them, all at once.
+static inline uint64_t LoadLower8(const char* p) {
+  constexpr uint64_t kOnes = 0x0101010101010101;
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  // Without their top bits, adding to the bytes can't carry from one to the next.
+  uint64_t low = x & (0x7f * kOnes);
+  uint64_t at_least_a = low + (0x80 - 'A') * kOnes;
+  uint64_t above_z = low + (0x80 - 'Z' - 1) * kOnes;
+  uint64_t upper = at_least_a & ~above_z & ~x & (0x80 * kOnes);
+  return x | (upper >> 2);
+}
+
+static bool AsciiEqualsIgnoreCase(const char* lhs, const char* rhs, size_t size) {
+#if defined(LIBBASE_STRINGS_VECTOR)
+  using V = internal::AsciiVector;
+  if (size >= V::kWidth) {
+    for (size_t i = 0; i + V::kWidth < size; i += V::kWidth) {
+      if (V::Equal(V::LoadLower(lhs + i), V::LoadLower(rhs + i)) != V::kAll) return false;
+    }
+    // Finish with a last vector that may overlap the one before it.
+    size_t last = size - V::kWidth;
+    return V::Equal(V::LoadLower(lhs + last), V::LoadLower(rhs + last)) == V::kAll;
+  }
+#endif
+  if (size >= 8) {
+    for (size_t i = 0; i + 8 < size; i += 8) {
+      if (LoadLower8(lhs + i) != LoadLower8(rhs + i)) return false;
+    }
+    return LoadLower8(lhs + size - 8) == LoadLower8(rhs + size - 8);
+  }
+  for (size_t i = 0; i < size; ++i) {
+    if (AsciiToLower(lhs[i]) != AsciiToLower(rhs[i])) return false;
+  }
+  return true;
+}
+
 bool StartsWithIgnoreCase(std::string_view s, std::string_view prefix) {
-  return s.size() >= prefix.size() && strncasecmp(s.data(), prefix.data(), prefix.size()) == 0;
+  return s.size() >= prefix.size() && AsciiEqualsIgnoreCase(s.data(), prefix.data(), prefix.size());
 }
 
 bool EndsWith(std::string_view s, std::string_view suffix) {
@@ -114,11 +418,48 @@ bool EndsWith(std::string_view s, char suffix) {
 
 bool EndsWithIgnoreCase(std::string_view s, std::string_view suffix) {
   return s.size() >= suffix.size() &&
-         strncasecmp(s.data() + (s.size() - suffix.size()), suffix.data(), suffix.size()) == 0;
+         AsciiEqualsIgnoreCase(s.data() + (s.size() - suffix.size()), suffix.data(), suffix.size());
 }
 
 bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
-  return lhs.size() == rhs.size() && strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+  return lhs.size() == rhs.size() && AsciiEqualsIgnoreCase(lhs.data(), rhs.data(), lhs.size());
+}
+
+size_t FindIgnoreCase(std::string_view haystack, std::string_view needle) {
+  if (needle.empty()) return 0;
+  if (needle.size() > haystack.size()) return std::string_view::npos;
+
+  const char* data = haystack.data();
+  size_t size = needle.size();
+  // The last position at which the needle could start.
+  size_t last = haystack.size() - size;
+  char first = AsciiToLower(needle.front());
+  size_t pos = 0;
+#if defined(LIBBASE_STRINGS_VECTOR)
+  // Look for the needle's first and last bytes a vector of candidate positions at a time, and only
+  // compare the rest of it where both match.
+  using V = internal::AsciiVector;
+  V::Vector firsts = V::Broadcast(first);
+  V::Vector lasts = V::Broadcast(AsciiToLower(needle.back()));
+  for (; pos + V::kWidth <= last + 1; pos += V::kWidth) {
+    uint64_t mask = V::Equal(V::LoadLower(data + pos), firsts) &
+                    V::Equal(V::LoadLower(data + pos + size - 1), lasts);
+    while (mask != 0) {
+      size_t candidate = pos + internal::CountTrailingZeros(mask);
+      if (AsciiEqualsIgnoreCase(data + candidate + 1, needle.data() + 1, size - 1)) {
+        return candidate;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; pos <= last; ++pos) {
+    if (AsciiToLower(data[pos]) == first &&
+        AsciiEqualsIgnoreCase(data + pos + 1, needle.data() + 1, size - 1)) {
+      return pos;
+    }
+  }
+  return std::string_view::npos;
 }
 
 std::string StringReplace(std::string_view s, std::string_view from, std::string_view to,
@@ -140,6 +481,119 @@ std::string StringReplace(std::string_view s, std::string_view from, std::string
   return result;
 }
 
+static std::string FirstBytes(
+    const std::vector<std::pair<std::string, std::string>>& replacements) {
+  std::string first_bytes;
+  for (const auto& [from, to] : replacements) {
+    if (!from.empty()) first_bytes += from[0];
+  }
+  return first_bytes;
+}
+
+StringReplacer::StringReplacer(
+    const std::vector<std::pair<std::string, std::string>>& replacements)
+    : first_bytes_(FirstBytes(replacements)) {
+  // Build the trie with a map per node, then flatten it.
+  std::vector<std::map<unsigned char, uint32_t>> children(1);
+  std::vector<int32_t> node_replacements(1, -1);
+  for (const auto& [from, to] : replacements) {
+    if (from.empty()) continue;
+    uint32_t node = 0;
+    for (char ch : from) {
+      auto [it, inserted] = children[node].emplace(static_cast<unsigned char>(ch), 0);
+      if (inserted) {
+        // Growing `children` may move the map `it` points into, so don't use `it` afterwards.
+        uint32_t child = children.size();
+        it->second = child;
+        children.emplace_back();
+        node_replacements.push_back(-1);
+        node = child;
+      } else {
+        node = it->second;
+      }
+    }
+    if (node_replacements[node] != -1) continue;
+    node_replacements[node] = to_.size();
+    to_.push_back(to);
+    if (to.size() > from.size()) grows_ = true;
+  }
+
+  nodes_.resize(children.size());
+  for (size_t i = 0; i < children.size(); ++i) {
+    nodes_[i].first_edge = edges_.size();
+    nodes_[i].edge_count = children[i].size();
+    nodes_[i].replacement = node_replacements[i];
+    for (const auto& [byte, target] : children[i]) edges_.push_back({byte, target});
+  }
+  for (const auto& [byte, target] : children[0]) root_[byte] = target;
+}
+
+int32_t StringReplacer::Match(std::string_view s, size_t pos, size_t* length) const {
+  uint32_t node = root_[static_cast<unsigned char>(s[pos])];
+  if (node == 0) return -1;
+  int32_t best = nodes_[node].replacement;
+  *length = 1;
+  for (size_t i = pos + 1; i < s.size(); ++i) {
+    const Node& current = nodes_[node];
+    auto edges_begin = edges_.begin() + current.first_edge;
+    auto edges_end = edges_begin + current.edge_count;
+    unsigned char byte = static_cast<unsigned char>(s[i]);
+    auto edge = std::lower_bound(edges_begin, edges_end, byte,
+                                 [](const Edge& edge, unsigned char b) { return edge.byte < b; });
+    if (edge == edges_end || edge->byte != byte) break;
+    node = edge->target;
+    if (nodes_[node].replacement != -1) {
+      best = nodes_[node].replacement;
+      *length = i + 1 - pos;
+    }
+  }
+  return best;
+}
+
+std::string StringReplacer::Replace(std::string_view s) const {
+  std::string result;
+  size_t copied = 0;
+  first_bytes_.FindEach(s, 0, [&](size_t pos) {
+    size_t length;
+    int32_t replacement = Match(s, pos, &length);
+    if (replacement == -1) return pos + 1;
+    if (copied == 0) result.reserve(s.size());
+    result.append(s.data() + copied, pos - copied);
+    result.append(to_[replacement]);
+    copied = pos + length;
+    return copied;
+  });
+  result.append(s.data() + copied, s.size() - copied);
+  return result;
+}
+
+void StringReplacer::ReplaceInPlace(std::string* s) const {
+  if (grows_) {
+    *s = Replace(*s);
+    return;
+  }
+
+  // Nothing grows, so the text written never catches up with the text still to be read.
+  char* data = s->data();
+  size_t written = 0;
+  size_t copied = 0;
+  first_bytes_.FindEach(*s, 0, [&](size_t pos) {
+    size_t length;
+    int32_t replacement = Match(*s, pos, &length);
+    if (replacement == -1) return pos + 1;
+    if (written != copied) memmove(data + written, data + copied, pos - copied);
+    written += pos - copied;
+    const std::string& to = to_[replacement];
+    memcpy(data + written, to.data(), to.size());
+    written += to.size();
+    copied = pos + length;
+    return copied;
+  });
+  if (written == copied) return;
+  memmove(data + written, data + copied, s->size() - copied);
+  s->resize(written + s->size() - copied);
+}
+
 std::string ErrnoNumberAsString(int errnum) {
   char buf[100];
   buf[0] = '\0';
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/strings.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#ifndef strncasecmp
+#define strncasecmp _strnicmp
+#endif
+
+// Something like /proc/self/maps: `lines` lines of space-separated fields.
+static std::string ProcLikePayload(int lines) {
+  std::string payload;
+  for (int i = 0; i < lines; ++i) {
+    payload += "7f0c4a1b2000-7f0c4a1d4000 r-xp 00000000 fd:01 " + std::to_string(1000000 + i) +
+               "                    /system/lib64/libexample.so\n";
+  }
+  return payload;
+}
+
+// What Split used to do: find_first_of per piece.
+static std::vector<std::string> SplitFindFirstOf(const std::string& s,
+                                                 const std::string& delimiters) {
+  std::vector<std::string> result;
+  size_t base = 0;
+  while (true) {
+    size_t found = s.find_first_of(delimiters, base);
+    result.push_back(s.substr(base, found - base));
+    if (found == s.npos) break;
+    base = found + 1;
+  }
+  return result;
+}
+
+static void BenchmarkSplitFindFirstOf(benchmark::State& state) {
+  std::string payload = ProcLikePayload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SplitFindFirstOf(payload, " \n"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkSplitFindFirstOf)->Arg(1)->Arg(100)->Arg(10000);
+
+static void BenchmarkSplit(benchmark::State& state) {
+  std::string payload = ProcLikePayload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::Split(payload, " \n"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkSplit)->Arg(1)->Arg(100)->Arg(10000);
+
+static void BenchmarkSplitToViews(benchmark::State& state) {
+  std::string payload = ProcLikePayload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::SplitToViews(payload, " \n"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkSplitToViews)->Arg(1)->Arg(100)->Arg(10000);
+
+static void BenchmarkTokenize(benchmark::State& state) {
+  std::string payload = ProcLikePayload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::Tokenize(payload, " \n"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkTokenize)->Arg(1)->Arg(100)->Arg(10000);
+
+static void BenchmarkTokenizeToViews(benchmark::State& state) {
+  std::string payload = ProcLikePayload(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::TokenizeToViews(payload, " \n"));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkTokenizeToViews)->Arg(1)->Arg(100)->Arg(10000);
+
+// Parsers that only want the first fields of a line needn't split the rest of it.
+static void BenchmarkSplitFirstTwoFields(benchmark::State& state) {
+  std::string line = ProcLikePayload(1);
+  for (auto _ : state) {
+    std::vector<std::string> fields = android::base::Split(line, " ");
+    benchmark::DoNotOptimize(fields[0]);
+    benchmark::DoNotOptimize(fields[1]);
+  }
+}
+BENCHMARK(BenchmarkSplitFirstTwoFields);
+
+static void BenchmarkSplitViewFirstTwoFields(benchmark::State& state) {
+  std::string line = ProcLikePayload(1);
+  for (auto _ : state) {
+    android::base::SplitView fields(line, " ");
+    auto it = fields.begin();
+    benchmark::DoNotOptimize(*it);
+    benchmark::DoNotOptimize(*++it);
+  }
+}
+BENCHMARK(BenchmarkSplitViewFirstTwoFields);
+
+// Parsing a config file: trimming every line of it.
+static std::vector<std::string> ConfigLines() {
+  std::vector<std::string> lines;
+  for (int i = 0; i < 1000; ++i) {
+    lines.push_back("    ro.example.property" + std::to_string(i) + " = value " +
+                    std::to_string(i) + "  \r");
+  }
+  return lines;
+}
+
+static void BenchmarkTrim(benchmark::State& state) {
+  std::vector<std::string> lines = ConfigLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) benchmark::DoNotOptimize(android::base::Trim(line));
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkTrim);
+
+static void BenchmarkTrimView(benchmark::State& state) {
+  std::vector<std::string> lines = ConfigLines();
+  for (auto _ : state) {
+    for (const auto& line : lines) benchmark::DoNotOptimize(android::base::TrimView(line));
+  }
+  state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BenchmarkTrimView);
+
+// What Join used to do: stream everything into an ostringstream.
+template <typename ContainerT, typename SeparatorT>
+static std::string JoinOstream(const ContainerT& things, SeparatorT separator) {
+  if (things.empty()) return "";
+  std::ostringstream result;
+  result << *things.begin();
+  for (auto it = std::next(things.begin()); it != things.end(); ++it) {
+    result << separator << *it;
+  }
+  return result.str();
+}
+
+static std::vector<std::string> JoinStrings(int count) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < count; ++i) {
+    strings.push_back("/system/lib64/lib" + std::to_string(i) + ".so");
+  }
+  return strings;
+}
+
+static std::vector<int> JoinInts(int count) {
+  std::vector<int> ints;
+  for (int i = 0; i < count; ++i) ints.push_back(i * 7919);
+  return ints;
+}
+
+static void BenchmarkJoinOstreamStrings(benchmark::State& state) {
+  std::vector<std::string> strings = JoinStrings(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(JoinOstream(strings, ','));
+  }
+}
+BENCHMARK(BenchmarkJoinOstreamStrings)->Arg(3)->Arg(100)->Arg(10000);
+
+static void BenchmarkJoinStrings(benchmark::State& state) {
+  std::vector<std::string> strings = JoinStrings(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::Join(strings, ','));
+  }
+}
+BENCHMARK(BenchmarkJoinStrings)->Arg(3)->Arg(100)->Arg(10000);
+
+static void BenchmarkAppendJoinStrings(benchmark::State& state) {
+  std::vector<std::string> strings = JoinStrings(state.range(0));
+  std::string result;
+  for (auto _ : state) {
+    result.clear();
+    android::base::AppendJoin(&result, strings, ',');
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BenchmarkAppendJoinStrings)->Arg(3)->Arg(100)->Arg(10000);
+
+static void BenchmarkJoinOstreamInts(benchmark::State& state) {
+  std::vector<int> ints = JoinInts(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(JoinOstream(ints, ','));
+  }
+}
+BENCHMARK(BenchmarkJoinOstreamInts)->Arg(3)->Arg(100)->Arg(10000);
+
+static void BenchmarkJoinInts(benchmark::State& state) {
+  std::vector<int> ints = JoinInts(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::Join(ints, ','));
+  }
+}
+BENCHMARK(BenchmarkJoinInts)->Arg(3)->Arg(100)->Arg(10000);
+
+// A sanitization pass: a dozen replacements over a payload.
+static const std::vector<std::pair<std::string, std::string>> kSanitizations = {
+    {"password=", "password=***"}, {"token=", "token=***"}, {"\r\n", "\n"}, {"\t", " "},
+    {"<", "&lt;"}, {">", "&gt;"}, {"\"", "&quot;"}, {"'", "&#39;"},
+    {"/data/user/0/", "/data/data/"}, {"\x1b[0m", ""}, {"\x1b[31m", ""}, {"\x1b[32m", ""},
+};
+
+static std::string SanitizationPayload(int lines) {
+  std::string payload;
+  for (int i = 0; i < lines; ++i) {
+    payload += "I/ActivityManager: Start proc " + std::to_string(1000 + i) +
+               ":com.example.app/u0a123 for service {com.example.app/.SyncService}\r\n";
+    if (i % 10 == 0) payload += "\tuser=\"alice\" token=abc123 path=/data/user/0/com.example\r\n";
+  }
+  return payload;
+}
+
+static void BenchmarkStringReplaceSeries(benchmark::State& state) {
+  std::string payload = SanitizationPayload(state.range(0));
+  for (auto _ : state) {
+    std::string result = payload;
+    for (const auto& [from, to] : kSanitizations) {
+      result = android::base::StringReplace(result, from, to, true);
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkStringReplaceSeries)->Arg(1)->Arg(100)->Arg(10000);
+
+static void BenchmarkStringReplacer(benchmark::State& state) {
+  std::string payload = SanitizationPayload(state.range(0));
+  android::base::StringReplacer replacer(kSanitizations);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(replacer.Replace(payload));
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BenchmarkStringReplacer)->Arg(1)->Arg(100)->Arg(10000);
+
+// Case-insensitive comparison and search, as in matching HTTP headers, from a single header name
+// to a whole request body.
+static std::string MixedCasePayload(size_t size) {
+  static constexpr std::string_view kText = "Content-Type: Text/HTML; Charset=UTF-8\r\n";
+  std::string payload;
+  while (payload.size() < size) payload += kText;
+  payload.resize(size);
+  return payload;
+}
+
+static std::string ToUpper(std::string s) {
+  for (char& ch : s) ch = toupper(ch);
+  return s;
+}
+
+static void BenchmarkStrncasecmp(benchmark::State& state) {
+  std::string lhs = MixedCasePayload(state.range(0));
+  std::string rhs = ToUpper(lhs);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(strncasecmp(lhs.data(), rhs.data(), lhs.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * lhs.size());
+}
+BENCHMARK(BenchmarkStrncasecmp)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+static void BenchmarkEqualsIgnoreCase(benchmark::State& state) {
+  std::string lhs = MixedCasePayload(state.range(0));
+  std::string rhs = ToUpper(lhs);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::EqualsIgnoreCase(lhs, rhs));
+  }
+  state.SetBytesProcessed(state.iterations() * lhs.size());
+}
+BENCHMARK(BenchmarkEqualsIgnoreCase)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+// The needle is at the very end, so the whole haystack is searched.
+static std::string Haystack(size_t size) {
+  std::string haystack = MixedCasePayload(size);
+  haystack.replace(haystack.size() - std::min<size_t>(6, haystack.size()), 6, "X-Tag:");
+  return haystack;
+}
+
+static void BenchmarkFindIgnoreCaseNaive(benchmark::State& state) {
+  std::string haystack = Haystack(state.range(0));
+  std::string needle = "x-tag:";
+  for (auto _ : state) {
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                          [](char lhs, char rhs) { return tolower(lhs) == tolower(rhs); });
+    benchmark::DoNotOptimize(it);
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+BENCHMARK(BenchmarkFindIgnoreCaseNaive)->RangeMultiplier(8)->Range(8, 64 << 10);
+
+static void BenchmarkFindIgnoreCase(benchmark::State& state) {
+  std::string haystack = Haystack(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(android::base::FindIgnoreCase(haystack, "x-tag:"));
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+BENCHMARK(BenchmarkFindIgnoreCase)->RangeMultiplier(8)->Range(8, 64 << 10);
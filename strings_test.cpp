@@ -18,6 +18,11 @@
 
 #include <gtest/gtest.h>
 
+#include <ctype.h>
+
+#include <algorithm>
+#include <limits>
+#include <list>
 #include <string>
 #include <vector>
 #include <set>
@@ -129,6 +134,148 @@ TEST(strings, tokenize_beginning_trailing_delimiters) {
   ASSERT_EQ("baz", parts[2]);
 }
 
+TEST(strings, split_to_views) {
+  std::string s = "foo:bar,,baz";
+  std::vector<std::string_view> parts = android::base::SplitToViews(s, ",:");
+  ASSERT_EQ(4U, parts.size());
+  ASSERT_EQ("foo", parts[0]);
+  ASSERT_EQ("bar", parts[1]);
+  ASSERT_EQ("", parts[2]);
+  ASSERT_EQ("baz", parts[3]);
+  // The views refer to the original string.
+  ASSERT_EQ(s.data(), parts[0].data());
+  ASSERT_EQ(s.data() + 9, parts[3].data());
+
+  parts = android::base::SplitToViews("", ",");
+  ASSERT_EQ(1U, parts.size());
+  ASSERT_EQ("", parts[0]);
+}
+
+TEST(strings, tokenize_to_views) {
+  std::vector<std::string_view> parts =
+      android::base::TokenizeToViews(" foo \tbar\t\t baz \t", " \t");
+  ASSERT_EQ(3U, parts.size());
+  ASSERT_EQ("foo", parts[0]);
+  ASSERT_EQ("bar", parts[1]);
+  ASSERT_EQ("baz", parts[2]);
+
+  ASSERT_EQ(0U, android::base::TokenizeToViews("", " ").size());
+  ASSERT_EQ(0U, android::base::TokenizeToViews("  \t ", " \t").size());
+}
+
+// The scanner works on 16 or 32 bytes at a time where it can, so check delimiters at every
+// position of strings long enough to need several vectors and a tail, against the obvious
+// implementation, for sets small enough to vectorize and too big to.
+TEST(strings, split_matches_find_first_of) {
+  auto reference = [](const std::string& s, const std::string& delimiters, bool skip_empty) {
+    std::vector<std::string> result;
+    size_t base = 0;
+    while (true) {
+      if (skip_empty) {
+        base = s.find_first_not_of(delimiters, base);
+        if (base == s.npos) break;
+      }
+      size_t found = s.find_first_of(delimiters, base);
+      result.push_back(s.substr(base, found - base));
+      if (found == s.npos) break;
+      base = found + 1;
+    }
+    return result;
+  };
+  auto to_strings = [](const std::vector<std::string_view>& views) {
+    return std::vector<std::string>(views.begin(), views.end());
+  };
+
+  const std::string delimiter_sets[] = {
+      ",", ",:", " \t\n", std::string("\0\xff", 2), "abcdefgh", "abcdefghi", "\x80\x90\xa0",
+  };
+  for (const std::string& delimiters : delimiter_sets) {
+    for (size_t size = 0; size < 100; ++size) {
+      for (size_t i = 0; i < size; ++i) {
+        // One delimiter at position i, and runs of them at both ends.
+        std::string s(size, 'x');
+        s[i] = delimiters[i % delimiters.size()];
+        if (size > 40) {
+          s[0] = s[1] = delimiters[0];
+          s[size - 1] = s[size - 2] = delimiters.back();
+        }
+        SCOPED_TRACE(testing::Message() << "delimiters=" << delimiters.size() << " s=" << s);
+        ASSERT_EQ(reference(s, delimiters, false), android::base::Split(s, delimiters));
+        ASSERT_EQ(reference(s, delimiters, false),
+                  to_strings(android::base::SplitToViews(s, delimiters)));
+        ASSERT_EQ(reference(s, delimiters, true), android::base::Tokenize(s, delimiters));
+        ASSERT_EQ(reference(s, delimiters, true),
+                  to_strings(android::base::TokenizeToViews(s, delimiters)));
+      }
+    }
+  }
+}
+
+static std::vector<std::string> ToVector(const android::base::SplitView& view) {
+  return std::vector<std::string>(view.begin(), view.end());
+}
+
+TEST(strings, split_view) {
+  using android::base::SplitView;
+  EXPECT_EQ((std::vector<std::string>{""}), ToVector(SplitView("", ",")));
+  EXPECT_EQ((std::vector<std::string>{"foo"}), ToVector(SplitView("foo", ",")));
+  EXPECT_EQ((std::vector<std::string>{"foo", "", "bar", ""}),
+            ToVector(SplitView("foo,:bar,", ",:")));
+}
+
+TEST(strings, split_view_skip_empty) {
+  using android::base::SplitView;
+  EXPECT_EQ(std::vector<std::string>{}, ToVector(SplitView("", " ").SkipEmpty()));
+  EXPECT_EQ(std::vector<std::string>{}, ToVector(SplitView(" \t ", " \t").SkipEmpty()));
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar", "baz"}),
+            ToVector(SplitView(" foo \tbar\t\t baz \t", " \t").SkipEmpty()));
+}
+
+TEST(strings, split_view_max_splits) {
+  using android::base::SplitView;
+  EXPECT_EQ((std::vector<std::string>{"a:b:c"}), ToVector(SplitView("a:b:c", ":").MaxSplits(0)));
+  EXPECT_EQ((std::vector<std::string>{"a", "b:c"}), ToVector(SplitView("a:b:c", ":").MaxSplits(1)));
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}),
+            ToVector(SplitView("a:b:c", ":").MaxSplits(2)));
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}),
+            ToVector(SplitView("a:b:c", ":").MaxSplits(10)));
+  EXPECT_EQ((std::vector<std::string>{"a", ""}), ToVector(SplitView("a:", ":").MaxSplits(1)));
+  EXPECT_EQ((std::vector<std::string>{"a", "b  c  "}),
+            ToVector(SplitView("  a  b  c  ", " ").SkipEmpty().MaxSplits(1)));
+}
+
+TEST(strings, split_view_chained_range_for) {
+  // The loop keeps only the result of the last call alive, so the chained calls on a temporary
+  // must hand back a SplitView rather than a reference to it.
+  using android::base::SplitView;
+  std::vector<std::string> pieces;
+  for (std::string_view piece : SplitView("  a  b  c  ", " ").SkipEmpty().MaxSplits(1)) {
+    pieces.emplace_back(piece);
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b  c  "}), pieces);
+
+  pieces.clear();
+  for (std::string_view piece : SplitView("a:b:c", ":").MaxSplits(1).SkipEmpty()) {
+    pieces.emplace_back(piece);
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b:c"}), pieces);
+}
+
+TEST(strings, split_view_early_termination) {
+  std::string line = "first second " + std::string(100000, 'x');
+  android::base::SplitView fields(line, " ");
+  auto it = fields.begin();
+  ASSERT_EQ("first", *it);
+  ASSERT_EQ(line.data(), it->data());
+  ++it;
+  ASSERT_EQ("second", *it);
+  auto copy = it++;
+  ASSERT_EQ("second", *copy);
+  ASSERT_NE(copy, it);
+  ASSERT_EQ(100000U, it->size());
+  ASSERT_EQ(fields.end(), ++it);
+}
+
 TEST(strings, trim_empty) {
   ASSERT_EQ("", android::base::Trim(""));
 }
@@ -173,6 +320,56 @@ TEST(strings, trim_build_implicit_string_view_conversion) {
   ASSERT_EQ("foo", android::base::Trim(Foo()));
 }
 
+TEST(strings, TrimView) {
+  std::string s = " \t foo bar \r\n";
+  std::string_view trimmed = android::base::TrimView(s);
+  ASSERT_EQ("foo bar", trimmed);
+  // No copy: the result points into `s`.
+  ASSERT_EQ(s.data() + 3, trimmed.data());
+
+  ASSERT_EQ("", android::base::TrimView(""));
+  ASSERT_EQ("", android::base::TrimView(" \t\n\v\f\r"));
+  ASSERT_EQ("foo", android::base::TrimView("foo"));
+
+  static_assert(android::base::TrimView("  foo  ") == "foo");
+}
+
+TEST(strings, TrimLeft_TrimRight) {
+  ASSERT_EQ("foo  ", android::base::TrimLeft("  foo  "));
+  ASSERT_EQ("  foo", android::base::TrimRight("  foo  "));
+  ASSERT_EQ("", android::base::TrimLeft("   "));
+  ASSERT_EQ("", android::base::TrimRight("   "));
+  ASSERT_EQ("", android::base::TrimLeft(""));
+  ASSERT_EQ("", android::base::TrimRight(""));
+}
+
+TEST(strings, TrimView_ascii_whitespace_only) {
+  for (int i = 0; i < 256; ++i) {
+    char ch = static_cast<char>(i);
+    bool space = i < 128 && isspace(i);
+    ASSERT_EQ(space, android::base::TrimView(std::string_view(&ch, 1)).empty()) << i;
+  }
+  // Neither NUL nor Latin-1's non-breaking space (0xa0) is whitespace.
+  using namespace std::string_literals;
+  ASSERT_EQ("\0foo\xa0"s, android::base::TrimView(" \0foo\xa0 "s));
+}
+
+TEST(strings, TrimInPlace) {
+  std::string s = "\t foo bar \n";
+  android::base::TrimInPlace(&s);
+  ASSERT_EQ("foo bar", s);
+  android::base::TrimInPlace(&s);
+  ASSERT_EQ("foo bar", s);
+
+  s = " \n ";
+  android::base::TrimInPlace(&s);
+  ASSERT_EQ("", s);
+
+  s = "";
+  android::base::TrimInPlace(&s);
+  ASSERT_EQ("", s);
+}
+
 TEST(strings, join_nothing) {
   std::vector<std::string> list = {};
   ASSERT_EQ("", android::base::Join(list, ','));
@@ -204,6 +401,58 @@ TEST(strings, join_unordered_set) {
               "2,1" == android::base::Join(list, ','));
 }
 
+TEST(strings, join_string_like) {
+  std::vector<const char*> pointers = {"foo", "bar"};
+  ASSERT_EQ("foo, bar", android::base::Join(pointers, ", "));
+  std::vector<std::string_view> views = {"foo", "", "bar"};
+  ASSERT_EQ("foo::bar", android::base::Join(views, std::string(":")));
+  std::list<char> chars = {'a', 'b', 'c'};
+  ASSERT_EQ("a-b-c", android::base::Join(chars, std::string_view("-")));
+}
+
+TEST(strings, join_integers) {
+  std::vector<int64_t> list = {std::numeric_limits<int64_t>::min(), 0,
+                               std::numeric_limits<int64_t>::max()};
+  ASSERT_EQ("-9223372036854775808 0 9223372036854775807", android::base::Join(list, ' '));
+  std::vector<uint64_t> unsigned_list = {std::numeric_limits<uint64_t>::max()};
+  ASSERT_EQ("18446744073709551615", android::base::Join(unsigned_list, ','));
+}
+
+TEST(strings, join_streamed) {
+  // Anything that isn't a string or an integer is still formatted with its operator<<.
+  std::vector<double> doubles = {1.5, 2.0};
+  ASSERT_EQ("1.5,2", android::base::Join(doubles, ','));
+  std::vector<bool> bools = {true, false};
+  ASSERT_EQ("1,0", android::base::Join(bools, ','));
+  std::vector<int> ints = {1, 2};
+  ASSERT_EQ("1 and 2", android::base::Join(ints, std::string(" and ")));
+}
+
+TEST(strings, AppendJoin) {
+  std::string result = "list: ";
+  std::vector<std::string> list = {"foo", "bar"};
+  android::base::AppendJoin(&result, list, ',');
+  ASSERT_EQ("list: foo,bar", result);
+  android::base::AppendJoin(&result, std::vector<std::string>{}, ',');
+  ASSERT_EQ("list: foo,bar", result);
+  android::base::AppendJoin(&result, std::set<int>{1, 2}, ";");
+  ASSERT_EQ("list: foo,bar1;2", result);
+}
+
+TEST(strings, AppendJoin_grows_geometrically) {
+  // Appending to the same buffer over and over mustn't reallocate it every time.
+  std::string result;
+  std::vector<std::string> list = {"foo", "bar"};
+  size_t reallocations = 0;
+  for (int i = 0; i < 10000; ++i) {
+    size_t capacity = result.capacity();
+    android::base::AppendJoin(&result, list, ',');
+    if (result.capacity() != capacity) ++reallocations;
+  }
+  ASSERT_EQ(70000U, result.size());
+  EXPECT_LT(reallocations, 40U);
+}
+
 TEST(strings, StartsWith_empty) {
   ASSERT_FALSE(android::base::StartsWith("", "foo"));
   ASSERT_TRUE(android::base::StartsWith("", ""));
@@ -354,6 +603,89 @@ TEST(strings, EqualsIgnoreCase) {
   ASSERT_FALSE(android::base::EqualsIgnoreCase("foo", "fool"));
 }
 
+TEST(strings, EqualsIgnoreCase_ascii_only) {
+  // Every pair of bytes, alone and in the middle of strings long enough to be compared a word or
+  // a vector at a time.  Only ASCII letters fold: not '@' and '`', '[' and '{', or Latin-1
+  // letters.
+  for (int i = 0; i < 256; ++i) {
+    for (int j = 0; j < 256; ++j) {
+      char lhs = static_cast<char>(i);
+      char rhs = static_cast<char>(j);
+      bool expected = lhs == rhs || (isalpha(i) && isalpha(j) && (i ^ j) == 0x20);
+      ASSERT_EQ(expected, android::base::EqualsIgnoreCase({&lhs, 1}, {&rhs, 1})) << i << " " << j;
+      std::string word_lhs = "Host:" + std::string(1, lhs) + "zZ@[";
+      std::string word_rhs = "hOST:" + std::string(1, rhs) + "Zz@[";
+      ASSERT_EQ(expected, android::base::EqualsIgnoreCase(word_lhs, word_rhs)) << i << " " << j;
+      std::string long_lhs = "Content-Length: 1234 " + std::string(1, lhs) + " Host: example.com";
+      std::string long_rhs = "CONTENT-length: 1234 " + std::string(1, rhs) + " HOST: EXAMPLE.COM";
+      ASSERT_EQ(expected, android::base::EqualsIgnoreCase(long_lhs, long_rhs)) << i << " " << j;
+    }
+  }
+}
+
+TEST(strings, EqualsIgnoreCase_embedded_nul) {
+  using namespace std::string_literals;
+  ASSERT_TRUE(android::base::EqualsIgnoreCase("a\0B"s, "A\0b"s));
+  ASSERT_FALSE(android::base::EqualsIgnoreCase("a\0b"s, "a\0c"s));
+  ASSERT_FALSE(android::base::StartsWithIgnoreCase("a\0b"s, "a\0c"s));
+  ASSERT_FALSE(android::base::EndsWithIgnoreCase("a\0b"s, "\0c"s));
+}
+
+TEST(strings, EqualsIgnoreCase_lengths) {
+  for (size_t size = 0; size < 100; ++size) {
+    std::string lower(size, 'x');
+    std::string upper(size, 'X');
+    ASSERT_TRUE(android::base::EqualsIgnoreCase(lower, upper)) << size;
+    ASSERT_TRUE(android::base::StartsWithIgnoreCase(lower + "tail", upper)) << size;
+    ASSERT_TRUE(android::base::EndsWithIgnoreCase("head" + lower, upper)) << size;
+    // A difference anywhere is found, whether in a whole vector or in what's left over.
+    for (size_t i = 0; i < size; ++i) {
+      std::string different = upper;
+      different[i] = 'Y';
+      ASSERT_FALSE(android::base::EqualsIgnoreCase(lower, different)) << size << " " << i;
+    }
+  }
+}
+
+TEST(strings, FindIgnoreCase) {
+  ASSERT_EQ(0U, android::base::FindIgnoreCase("", ""));
+  ASSERT_EQ(0U, android::base::FindIgnoreCase("foo", ""));
+  ASSERT_EQ(std::string_view::npos, android::base::FindIgnoreCase("", "foo"));
+  ASSERT_EQ(std::string_view::npos, android::base::FindIgnoreCase("fo", "foo"));
+  ASSERT_EQ(0U, android::base::FindIgnoreCase("Foo", "fOO"));
+  ASSERT_EQ(4U, android::base::FindIgnoreCase("foo BAR bar", "bar"));
+  ASSERT_EQ(std::string_view::npos, android::base::FindIgnoreCase("foo bar", "baz"));
+  ASSERT_EQ(16U, android::base::FindIgnoreCase("GET / HTTP/1.1\r\nContent-Type: text/html",
+                                               "content-type:"));
+
+  ASSERT_TRUE(android::base::ContainsIgnoreCase("Accept-Encoding: GZIP", "gzip"));
+  ASSERT_FALSE(android::base::ContainsIgnoreCase("Accept-Encoding: deflate", "gzip"));
+}
+
+TEST(strings, FindIgnoreCase_matches_naive_search) {
+  auto naive = [](std::string_view haystack, std::string_view needle) {
+    auto equal = [](char lhs, char rhs) { return tolower(lhs) == tolower(rhs); };
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), equal);
+    return it == haystack.end() && !needle.empty() ? std::string_view::npos
+                                                   : size_t(it - haystack.begin());
+  };
+  // Few distinct letters, so that there are plenty of near misses; and needles at every offset
+  // relative to the vectors, including straddling the end of the last whole one.
+  std::string_view pattern = "aAbBaabAAbaBBa";
+  std::string haystack;
+  for (size_t i = 0; i < 150; ++i) haystack += pattern[(i * 7 + i / 5) % pattern.size()];
+  for (size_t start = 0; start < haystack.size(); start += 3) {
+    for (size_t size = 1; size <= 40 && start + size <= haystack.size(); ++size) {
+      std::string needle = haystack.substr(start, size);
+      for (size_t end = 0; end <= haystack.size(); end += 7) {
+        std::string_view h = std::string_view(haystack).substr(0, end);
+        ASSERT_EQ(naive(h, needle), android::base::FindIgnoreCase(h, needle))
+            << start << " " << size << " " << end;
+      }
+    }
+  }
+}
+
 TEST(strings, ubsan_28729303) {
   android::base::Split("/dev/null", ":");
 }
@@ -417,6 +749,73 @@ TEST(strings, StringReplace_true) {
   ASSERT_EQ("<xx>", android::base::StringReplace("<abcabc>", "abc", "x", true));
 }
 
+TEST(strings, StringReplacer) {
+  android::base::StringReplacer replacer({{"<", "&lt;"}, {">", "&gt;"}, {"&", "&amp;"}});
+  ASSERT_EQ("", replacer.Replace(""));
+  ASSERT_EQ("abc", replacer.Replace("abc"));
+  ASSERT_EQ("a&lt;b&amp;c&gt;", replacer.Replace("a<b&c>"));
+  ASSERT_EQ("&lt;&lt;&lt;", replacer.Replace("<<<"));
+  // Replaced text isn't searched again.
+  ASSERT_EQ("&amp;lt;", replacer.Replace("&lt;"));
+}
+
+TEST(strings, StringReplacer_longest_match_wins) {
+  android::base::StringReplacer replacer(
+      {{"a", "1"}, {"abc", "3"}, {"ab", "2"}, {"abc", "ignored"}, {"", "ignored"}, {"bcd", "x"}});
+  ASSERT_EQ("3", replacer.Replace("abc"));
+  ASSERT_EQ("2", replacer.Replace("ab"));
+  ASSERT_EQ("2x", replacer.Replace("abbcd"));
+  // Leftmost first: "abc" is taken before "bcd" is considered.
+  ASSERT_EQ("3d", replacer.Replace("abcd"));
+  ASSERT_EQ("11", replacer.Replace("aa"));
+}
+
+TEST(strings, StringReplacer_no_replacements) {
+  android::base::StringReplacer replacer({});
+  ASSERT_EQ("abc", replacer.Replace("abc"));
+  std::string s = "abc";
+  replacer.ReplaceInPlace(&s);
+  ASSERT_EQ("abc", s);
+}
+
+TEST(strings, StringReplacer_ReplaceInPlace) {
+  // Nothing grows, so this is done in place.
+  android::base::StringReplacer shrinking({{"password=", "pw="}, {"\r\n", "\n"}, {"x", "y"}});
+  std::string s = "user=x\r\npassword=secret\r\n";
+  const char* data = s.data();
+  shrinking.ReplaceInPlace(&s);
+  ASSERT_EQ("user=y\npw=secret\n", s);
+  ASSERT_EQ(data, s.data());
+
+  // Something grows, so this can't be.
+  android::base::StringReplacer growing({{"\n", "\\n"}, {"\t", ""}});
+  s = "a\tb\nc\n";
+  growing.ReplaceInPlace(&s);
+  ASSERT_EQ("ab\\nc\\n", s);
+}
+
+// Replacing a series of pairs one by one with StringReplace gives the same result as a
+// StringReplacer, when no `from` can overlap another or its replacement.
+TEST(strings, StringReplacer_matches_StringReplace) {
+  std::vector<std::pair<std::string, std::string>> pairs = {
+      {"foo", "F"}, {"bar", "barbar"}, {"\xff\x80", "?"}, {"q", ""}, {"0123456789", "digits"},
+  };
+  android::base::StringReplacer replacer(pairs);
+  std::string_view pattern = "xfooq\xff\x80 bar 0123456789 ba fo ";
+  std::string s;
+  for (size_t i = 0; i < 200; ++i) {
+    s += pattern[i % pattern.size()];
+    std::string expected = s;
+    for (const auto& [from, to] : pairs) {
+      expected = android::base::StringReplace(expected, from, to, true);
+    }
+    ASSERT_EQ(expected, replacer.Replace(s));
+    std::string in_place = s;
+    replacer.ReplaceInPlace(&in_place);
+    ASSERT_EQ(expected, in_place);
+  }
+}
+
 TEST(strings, ErrnoNumberAsString) {
   EXPECT_EQ("No such file or directory", android::base::ErrnoNumberAsString(ENOENT));
 }